@@ -1,23 +1,26 @@
 #include <cglm/cglm.h>
 #include "Utils.h"
 #include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
 #define numVAOs 1
-#define numVBOs 1
+#define numVBOs 2   // vertices, indices
 
 float cameraX, cameraY, cameraZ;
 GLuint renderingProgram;
 GLuint vao[numVAOs];
 GLuint vbo[numVBOs];
+GLsizei cubeIndexCount;
 
 // Allocate variables used in display() function
 int width, height;
 float aspect;
 float timeFactor;
-GLuint mvLoc, projLoc, tfLoc;
+GLint mvLoc, projLoc, tfLoc;
+UtilsUniformTable uniforms;
 mat4 pMat, vMat, mMat, mvMat;
 
 void setupVertices(void) {
@@ -39,12 +42,22 @@ void setupVertices(void) {
     glGenVertexArrays(numVAOs, vao);
     glBindVertexArray(vao[0]);
     glGenBuffers(numVBOs, vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertexPositions), vertexPositions, GL_STATIC_DRAW);
+    // Every instance shades 8 shared corners instead of 36 separate vertices
+    cubeIndexCount = (GLsizei)utils_mesh_upload("cube", vertexPositions, 36, 3, vbo[0], vbo[1]);
+    if (cubeIndexCount == 0) {
+        exit(EXIT_FAILURE);
+    }
 }
 
 void init(GLFWwindow* window) {
     renderingProgram = create_shader_program("shaders/vertShader.glsl", "shaders/fragShader.glsl");
+
+    // Resolve uniform locations once instead of every frame
+    utils_uniform_table_init(&uniforms, renderingProgram);
+    mvLoc = utils_uniform_location(&uniforms, "v_matrix");
+    projLoc = utils_uniform_location(&uniforms, "proj_matrix");
+    tfLoc = utils_uniform_location(&uniforms, "tf");
+
     cameraX = 0.0f; cameraY = 0.0f; cameraZ = 420.0f;
     setupVertices();
 }
@@ -53,10 +66,6 @@ void display(GLFWwindow* window, double currentTime) {
     glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
     glUseProgram(renderingProgram);
 
-    // Get uniform locations
-    mvLoc = glGetUniformLocation(renderingProgram, "v_matrix");
-    projLoc = glGetUniformLocation(renderingProgram, "proj_matrix");
-
     // Get framebuffer size and set viewport
     glfwGetFramebufferSize(window, &width, &height);
         glViewport(0, 0, width, height);  // Set the viewport to cover the entire window
@@ -71,15 +80,14 @@ void display(GLFWwindow* window, double currentTime) {
     glm_translate(vMat, (vec3){-cameraX, -cameraY, -cameraZ});
 
     // Set uniforms
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, (float*)pMat);
-    glUniformMatrix4fv(mvLoc, 1, GL_FALSE, (float*)vMat);
+    utils_uniform_set_mat4(projLoc, (float*)pMat);
+    utils_uniform_set_mat4(mvLoc, (float*)vMat);
 
     // Set time factor for animation
     timeFactor = (float)currentTime;
-    tfLoc = glGetUniformLocation(renderingProgram, "tf");
-    glUniform1f(tfLoc, timeFactor);
+    utils_uniform_set_float(tfLoc, timeFactor);
 
-    // Bind VBO and set up vertex attribute
+    // Bind VBO and set up vertex attribute; the VAO keeps the index buffer binding
     glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
     glEnableVertexAttribArray(0);
@@ -87,7 +95,7 @@ void display(GLFWwindow* window, double currentTime) {
     // Enable depth testing and render the cubes
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LEQUAL);
-    glDrawArraysInstanced(GL_TRIANGLES, 0, 36, 100000);
+    glDrawElementsInstanced(GL_TRIANGLES, cubeIndexCount, GL_UNSIGNED_INT, 0, 100000);
 }
 
 int main(void) {
@@ -3,13 +3,27 @@
 #include <stdlib.h>
 #include <string.h>
 
-#if !defined(USE_CGLM) && !defined(USE_RAYMATH)
 #include <math.h>
+#include <time.h>
+
+#if defined(UTILS_BATCH_THREADS)
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+// File views map files directly on POSIX; emscripten's mmap copies anyway, so it reads instead
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+#define UTILS_HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 // File operations
-char* read_file(const char* file_path) {
-    FILE* file = fopen(file_path, "r");
+// Reads the whole file in binary mode into a NUL-terminated heap buffer
+static char* read_file_buffered(const char* file_path, size_t* out_length) {
+    FILE* file = fopen(file_path, "rb");
     if (file == NULL) {
         printf("Failed to open file: %s\n", file_path);
         return NULL;
@@ -18,6 +32,11 @@ char* read_file(const char* file_path) {
     fseek(file, 0, SEEK_END);
     long file_size = ftell(file);
     rewind(file);
+    if (file_size < 0) {
+        printf("Failed to get file size: %s\n", file_path);
+        fclose(file);
+        return NULL;
+    }
 
     char* content = (char*)malloc(file_size + 1);
     if (content == NULL) {
@@ -26,16 +45,80 @@ char* read_file(const char* file_path) {
         return NULL;
     }
 
-    fread(content, 1, file_size, file);
-    content[file_size] = '\0';
+    size_t read_length = fread(content, 1, file_size, file);
+    content[read_length] = '\0';
+    if (out_length != NULL) {
+        *out_length = read_length;
+    }
 
     fclose(file);
     return content;
 }
 
+char* read_file(const char* file_path) {
+    return read_file_buffered(file_path, NULL);
+}
+
+int utils_file_view_open(const char* file_path, UtilsFileView* view) {
+    view->data = NULL;
+    view->length = 0;
+    view->mapped = 0;
+
+#if defined(UTILS_HAVE_MMAP)
+    int fd = open(file_path, O_RDONLY);
+    if (fd < 0) {
+        printf("Failed to open file: %s\n", file_path);
+        return 0;
+    }
+    struct stat st;
+    // Empty files cannot be mapped; they take the buffered path below
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            close(fd);
+            view->data = (const char*)data;
+            view->length = (size_t)st.st_size;
+            view->mapped = 1;
+            return 1;
+        }
+    }
+    close(fd);
+#endif
+
+    size_t length = 0;
+    char* content = read_file_buffered(file_path, &length);
+    if (content == NULL) {
+        return 0;
+    }
+    view->data = content;
+    view->length = length;
+    return 1;
+}
+
+void utils_file_view_close(UtilsFileView* view) {
+    if (view->data != NULL) {
+#if defined(UTILS_HAVE_MMAP)
+        if (view->mapped) {
+            munmap((void*)view->data, view->length);
+        } else
+#endif
+        {
+            free((void*)view->data);
+        }
+    }
+    view->data = NULL;
+    view->length = 0;
+    view->mapped = 0;
+}
+
 // OpenGL-specific functions
 #ifdef USE_OPENGL
 #include <GL/glew.h>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
 
 int check_opengl_error(void) {
     int found_error = 0;
@@ -47,6 +130,25 @@ int check_opengl_error(void) {
     return found_error;
 }
 
+static void GLAPIENTRY debug_output_callback(GLenum source, GLenum type, GLuint id, GLenum severity,
+                                             GLsizei length, const GLchar* message, const void* user_param) {
+    (void)source; (void)id; (void)length; (void)user_param;
+    const char* level = severity == GL_DEBUG_SEVERITY_HIGH ? "high" :
+                        severity == GL_DEBUG_SEVERITY_MEDIUM ? "medium" : "low";
+    printf("GL debug (%s%s): %s\n", type == GL_DEBUG_TYPE_ERROR ? "error, " : "", level, message);
+}
+
+int utils_enable_debug_output(void) {
+    if (!(GLEW_VERSION_4_3 || GLEW_KHR_debug)) {
+        return 0;
+    }
+    glEnable(GL_DEBUG_OUTPUT);
+    glDebugMessageCallback(debug_output_callback, NULL);
+    // Notifications are informational chatter (buffer placement and the like)
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, NULL, GL_FALSE);
+    return 1;
+}
+
 void print_shader_log(unsigned int shader) {
     int len = 0;
     int chars_written = 0;
@@ -73,18 +175,12 @@ void print_program_log(int prog) {
     }
 }
 
-unsigned int prepare_shader(int shader_type, const char* shader_path) {
-    unsigned int shader_ref;
+// Compiles one stage from source already in memory
+static unsigned int compile_shader_source(int shader_type, const char* source, size_t length) {
     int shader_compiled;
-    
-    char* shader_str = read_file(shader_path);
-    if (shader_str == NULL) {
-        return 0;
-    }
-    
-    shader_ref = glCreateShader(shader_type);
-    const char* shader_src = shader_str;
-    glShaderSource(shader_ref, 1, &shader_src, NULL);
+    unsigned int shader_ref = glCreateShader(shader_type);
+    GLint source_length = (GLint)length;
+    glShaderSource(shader_ref, 1, &source, &source_length);
     glCompileShader(shader_ref);
     check_opengl_error();
     
@@ -93,8 +189,17 @@ unsigned int prepare_shader(int shader_type, const char* shader_path) {
         printf("Shader compilation error.\n");
         print_shader_log(shader_ref);
     }
+    return shader_ref;
+}
+
+unsigned int prepare_shader(int shader_type, const char* shader_path) {
+    UtilsFileView source;
+    if (!utils_file_view_open(shader_path, &source)) {
+        return 0;
+    }
     
-    free(shader_str);
+    unsigned int shader_ref = compile_shader_source(shader_type, source.data, source.length);
+    utils_file_view_close(&source);
     return shader_ref;
 }
 
@@ -110,217 +215,2772 @@ int finalize_shader_program(unsigned int program) {
     return program;
 }
 
-unsigned int create_shader_program(const char* vp, const char* fp) {
-    unsigned int v_shader = prepare_shader(GL_VERTEX_SHADER, vp);
-    unsigned int f_shader = prepare_shader(GL_FRAGMENT_SHADER, fp);
-    unsigned int vf_program = glCreateProgram();
-    glAttachShader(vf_program, v_shader);
-    glAttachShader(vf_program, f_shader);
-    return finalize_shader_program(vf_program);
-}
+static int program_cache_supported(void);
 
-unsigned int create_shader_program_with_geometry(const char* vp, const char* gp, const char* fp) {
-    unsigned int v_shader = prepare_shader(GL_VERTEX_SHADER, vp);
-    unsigned int g_shader = prepare_shader(GL_GEOMETRY_SHADER, gp);
-    unsigned int f_shader = prepare_shader(GL_FRAGMENT_SHADER, fp);
-    unsigned int vgf_program = glCreateProgram();
-    glAttachShader(vgf_program, v_shader);
-    glAttachShader(vgf_program, g_shader);
-    glAttachShader(vgf_program, f_shader);
-    return finalize_shader_program(vgf_program);
+// Compiles and links every stage without asking for status, so the driver can work on
+// all of them (and on other programs) before anyone blocks. Cache hits come back ready.
+static int program_submit(const char* const* paths, const int* types, int count, UtilsBatchProgram* entry) {
+    UtilsFileView views[UTILS_PROGRAM_MAX_STAGES];
+    const char* sources[UTILS_PROGRAM_MAX_STAGES];
+    size_t lengths[UTILS_PROGRAM_MAX_STAGES];
+    memset(entry, 0, sizeof(*entry));
+    entry->status = UTILS_PROGRAM_FAILED;
+
+    int opened = 0;
+    for (; opened < count; opened++) {
+        if (!utils_file_view_open(paths[opened], &views[opened])) {
+            break;
+        }
+        sources[opened] = views[opened].data;
+        lengths[opened] = views[opened].length;
+    }
+
+    if (opened == count) {
+        entry->cache_key = utils_program_cache_key(sources, lengths, count);
+        entry->program = utils_program_cache_load(entry->cache_key);
+        if (entry->program != 0) {
+            entry->status = UTILS_PROGRAM_READY;
+        } else {
+            entry->program = glCreateProgram();
+            for (int i = 0; i < count; i++) {
+                unsigned int shader = glCreateShader(types[i]);
+                GLint length = (GLint)lengths[i];
+                glShaderSource(shader, 1, &sources[i], &length);
+                glCompileShader(shader);
+                glAttachShader(entry->program, shader);
+                entry->shaders[entry->shader_count++] = shader;
+            }
+            if (program_cache_supported()) {
+                glProgramParameteri(entry->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+            }
+            glLinkProgram(entry->program);
+            entry->status = UTILS_PROGRAM_PENDING;
+        }
+    }
+
+    for (int i = 0; i < opened; i++) {
+        utils_file_view_close(&views[i]);
+    }
+    return opened == count;
 }
-#endif // USE_OPENGL
 
-// Math functions
-#if !defined(USE_CGLM) && !defined(USE_RAYMATH)
-void matrix_multiply(float* m1, float* m2, float* result) {
-    for (int i = 0; i < 4; i++) {
-        for (int j = 0; j < 4; j++) {
-            result[i * 4 + j] = 0.0f;
-            for (int k = 0; k < 4; k++) {
-                result[i * 4 + j] += m1[i * 4 + k] * m2[k * 4 + j];
+// Reads the link status (blocking if the driver is still busy), reports errors,
+// stores successful programs in the cache and releases the shader objects
+static void program_finalize(UtilsBatchProgram* entry) {
+    int linked = 0;
+    glGetProgramiv(entry->program, GL_LINK_STATUS, &linked);
+    if (linked == 1) {
+        utils_program_cache_store(entry->program, entry->cache_key);
+        entry->status = UTILS_PROGRAM_READY;
+    } else {
+        // Compile status is only worth querying once the link has already failed
+        for (int i = 0; i < entry->shader_count; i++) {
+            int compiled = 0;
+            glGetShaderiv(entry->shaders[i], GL_COMPILE_STATUS, &compiled);
+            if (compiled != 1) {
+                printf("Shader compilation error.\n");
+                print_shader_log(entry->shaders[i]);
             }
         }
+        printf("Linking failed\n");
+        print_program_log(entry->program);
+        entry->status = UTILS_PROGRAM_FAILED;
+    }
+    for (int i = 0; i < entry->shader_count; i++) {
+        glDetachShader(entry->program, entry->shaders[i]);
+        glDeleteShader(entry->shaders[i]);
     }
+    entry->shader_count = 0;
 }
 
-void matrix_translate(float* m, float x, float y, float z) {
-    float translation[16] = {
-        1.0f, 0.0f, 0.0f, 0.0f,
-        0.0f, 1.0f, 0.0f, 0.0f,
-        0.0f, 0.0f, 1.0f, 0.0f,
-        x,    y,    z,    1.0f
-    };
-    float result[16];
-    matrix_multiply(m, translation, result);
-    memcpy(m, result, 16 * sizeof(float));
+// Builds a single program, still deferring every status query until after the link
+static unsigned int build_program(const char* const* paths, const int* types, int count) {
+    UtilsBatchProgram entry;
+    if (!program_submit(paths, types, count, &entry)) {
+        return 0;
+    }
+    if (entry.status == UTILS_PROGRAM_PENDING) {
+        program_finalize(&entry);
+    }
+    return entry.program;
 }
 
-void matrix_rotate(float* m, float angle, float x, float y, float z) {
-    float radians = angle * 3.14159f / 180.0f;
-    float c = cosf(radians);
-    float s = sinf(radians);
-    float magnitude = sqrtf(x*x + y*y + z*z);
-    float nx = x / magnitude;
-    float ny = y / magnitude;
-    float nz = z / magnitude;
-    float rotation[16] = {
-        nx*nx*(1-c)+c,    ny*nx*(1-c)+nz*s, nz*nx*(1-c)-ny*s, 0.0f,
-        nx*ny*(1-c)-nz*s, ny*ny*(1-c)+c,    nz*ny*(1-c)+nx*s, 0.0f,
-        nx*nz*(1-c)+ny*s, ny*nz*(1-c)-nx*s, nz*nz*(1-c)+c,    0.0f,
-        0.0f,             0.0f,             0.0f,             1.0f
-    };
-    float result[16];
-    matrix_multiply(m, rotation, result);
-    memcpy(m, result, 16 * sizeof(float));
+unsigned int create_shader_program(const char* vp, const char* fp) {
+    const char* paths[] = { vp, fp };
+    const int types[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+    return build_program(paths, types, 2);
 }
 
-void matrix_scale(float* m, float x, float y, float z) {
-    float scale[16] = {
-        x,    0.0f, 0.0f, 0.0f,
-        0.0f, y,    0.0f, 0.0f,
-        0.0f, 0.0f, z,    0.0f,
-        0.0f, 0.0f, 0.0f, 1.0f
-    };
-    float result[16];
-    matrix_multiply(m, scale, result);
-    memcpy(m, result, 16 * sizeof(float));
+unsigned int create_shader_program_with_geometry(const char* vp, const char* gp, const char* fp) {
+    const char* paths[] = { vp, gp, fp };
+    const int types[] = { GL_VERTEX_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER };
+    return build_program(paths, types, 3);
 }
 
-void matrix_perspective(float* m, float fovy, float aspect, float near, float far) {
-    float f = 1.0f / tanf(fovy / 2.0f);
-    float nf = 1.0f / (near - far);
+// Program binary cache
+// Each entry is <dir>/<key>.bin: a fixed header followed by the driver's binary blob
+#define PROGRAM_CACHE_MAGIC 0x43425055u   // "UPBC"
+#define PROGRAM_CACHE_VERSION 1u
+#define PROGRAM_CACHE_MAX_PATH 512
+// Room for the directory plus "/<16 hex digits>.bin" and its terminator
+#define PROGRAM_CACHE_PATH_SIZE (PROGRAM_CACHE_MAX_PATH + 21)
 
-    m[0] = f / aspect;
-    m[1] = 0.0f;
-    m[2] = 0.0f;
-    m[3] = 0.0f;
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;      // binary format reported by glGetProgramBinary
+    uint32_t length;      // blob size in bytes
+    uint64_t key;         // repeated so a renamed or mixed-up file is rejected
+    uint64_t checksum;    // FNV-1a of the blob
+} ProgramCacheHeader;
 
-    m[4] = 0.0f;
-    m[5] = f;
-    m[6] = 0.0f;
-    m[7] = 0.0f;
+static char program_cache_dir[PROGRAM_CACHE_MAX_PATH] = UTILS_PROGRAM_CACHE_DEFAULT_DIR;
+static int program_cache_enabled = 1;
 
-    m[8] = 0.0f;
-    m[9] = 0.0f;
-    m[10] = (far + near) * nf;
-    m[11] = -1.0f;
+static uint64_t fnv1a64(uint64_t hash, const void* data, size_t length) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
 
-    m[12] = 0.0f;
-    m[13] = 0.0f;
-    m[14] = 2.0f * far * near * nf;
-    m[15] = 0.0f;
+#define FNV1A64_OFFSET 0xCBF29CE484222325ull
+
+// Binaries need GL 4.1 / ARB_get_program_binary and at least one format from the driver
+static int program_cache_supported(void) {
+    if (!program_cache_enabled || !(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)) {
+        return 0;
+    }
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
 }
 
-void matrix_identity(float* m) {
-    m[0] = 1.0f; m[4] = 0.0f; m[8] = 0.0f; m[12] = 0.0f;
-    m[1] = 0.0f; m[5] = 1.0f; m[9] = 0.0f; m[13] = 0.0f;
-    m[2] = 0.0f; m[6] = 0.0f; m[10] = 1.0f; m[14] = 0.0f;
-    m[3] = 0.0f; m[7] = 0.0f; m[11] = 0.0f; m[15] = 1.0f;
+static void program_cache_path(uint64_t key, char* path, size_t size) {
+    snprintf(path, size, "%s/%016llx.bin", program_cache_dir, (unsigned long long)key);
 }
-#endif // !defined(USE_CGLM) && !defined(USE_RAYMATH)
 
-// Wrapper functions for matrix operations
-void utils_matrix_multiply(float* m1, float* m2, float* result) {
-#ifdef USE_CGLM
-    glm_mat4_mul((vec4*)m1, (vec4*)m2, (vec4*)result);
-#elif defined(USE_RAYMATH)
-    *((Matrix*)result) = MatrixMultiply(*((Matrix*)m1), *((Matrix*)m2));
-#else
-    matrix_multiply(m1, m2, result);
-#endif
+void utils_program_cache_set_dir(const char* dir) {
+    if (dir == NULL) {
+        program_cache_enabled = 0;
+        return;
+    }
+    snprintf(program_cache_dir, sizeof(program_cache_dir), "%s", dir);
+    program_cache_enabled = 1;
 }
 
-void utils_matrix_translate(float* m, float x, float y, float z) {
-#ifdef USE_CGLM
-    glm_translate((vec4*)m, (vec3){x, y, z});
-#elif defined(USE_RAYMATH)
-    *((Matrix*)m) = MatrixMultiply(*((Matrix*)m), MatrixTranslate(x, y, z));
-#else
-    matrix_translate(m, x, y, z);
-#endif
+uint64_t utils_program_cache_key(const char* const* sources, const size_t* lengths, int count) {
+    uint64_t hash = FNV1A64_OFFSET;
+    const GLenum driver_strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    for (int i = 0; i < 3; i++) {
+        const char* str = (const char*)glGetString(driver_strings[i]);
+        if (str != NULL) {
+            hash = fnv1a64(hash, str, strlen(str) + 1);
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        // Hash the length too, so moving text between stages changes the key
+        uint64_t length = (uint64_t)lengths[i];
+        hash = fnv1a64(hash, &length, sizeof(length));
+        hash = fnv1a64(hash, sources[i], lengths[i]);
+    }
+    return hash;
 }
 
-void utils_matrix_rotate(float* m, float angle, float x, float y, float z) {
-#ifdef USE_CGLM
-    glm_rotate((vec4*)m, angle, (vec3){x, y, z});
-#elif defined(USE_RAYMATH)
-    *((Matrix*)m) = MatrixMultiply(*((Matrix*)m), MatrixRotate((Vector3){x, y, z}, angle));
-#else
-    matrix_rotate(m, angle, x, y, z);
-#endif
+unsigned int utils_program_cache_load(uint64_t key) {
+    if (!program_cache_supported()) {
+        return 0;
+    }
+
+    char path[PROGRAM_CACHE_PATH_SIZE];
+    program_cache_path(key, path, sizeof(path));
+    FILE* probe = fopen(path, "rb");
+    if (probe == NULL) {
+        return 0;   // plain miss
+    }
+    fclose(probe);
+
+    UtilsFileView view;
+    if (!utils_file_view_open(path, &view)) {
+        return 0;
+    }
+
+    unsigned int program = 0;
+    ProgramCacheHeader header;
+    if (view.length >= sizeof(header)) {
+        memcpy(&header, view.data, sizeof(header));
+        const char* blob = view.data + sizeof(header);
+        if (header.magic == PROGRAM_CACHE_MAGIC && header.version == PROGRAM_CACHE_VERSION &&
+            header.key == key && header.length == view.length - sizeof(header) &&
+            header.checksum == fnv1a64(FNV1A64_OFFSET, blob, header.length)) {
+            program = glCreateProgram();
+            glProgramBinary(program, (GLenum)header.format, blob, (GLsizei)header.length);
+            GLint linked = 0;
+            glGetProgramiv(program, GL_LINK_STATUS, &linked);
+            if (linked != 1) {
+                // The driver rejected the binary (e.g. after an update that kept the version string)
+                glDeleteProgram(program);
+                program = 0;
+            }
+        }
+    }
+    utils_file_view_close(&view);
+
+    if (program == 0) {
+        printf("Discarding stale program cache entry: %s\n", path);
+        remove(path);
+    }
+    return program;
 }
 
-void utils_matrix_scale(float* m, float x, float y, float z) {
-#ifdef USE_CGLM
-    glm_scale((vec4*)m, (vec3){x, y, z});
-#elif defined(USE_RAYMATH)
-    *((Matrix*)m) = MatrixMultiply(*((Matrix*)m), MatrixScale(x, y, z));
+int utils_program_cache_store(unsigned int program, uint64_t key) {
+    GLint linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked != 1 || !program_cache_supported()) {
+        return 0;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return 0;
+    }
+    char* blob = (char*)malloc((size_t)length);
+    if (blob == NULL) {
+        return 0;
+    }
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, blob);
+    if (written <= 0) {
+        free(blob);
+        return 0;
+    }
+
+    ProgramCacheHeader header = {
+        .magic = PROGRAM_CACHE_MAGIC,
+        .version = PROGRAM_CACHE_VERSION,
+        .format = (uint32_t)format,
+        .length = (uint32_t)written,
+        .key = key,
+        .checksum = fnv1a64(FNV1A64_OFFSET, blob, (size_t)written)
+    };
+
+#ifdef _WIN32
+    _mkdir(program_cache_dir);
 #else
-    matrix_scale(m, x, y, z);
+    mkdir(program_cache_dir, 0755);
 #endif
-}
 
-void utils_matrix_perspective(float* m, float fovy, float aspect, float near, float far) {
-#ifdef USE_CGLM
-    glm_perspective(fovy, aspect, near, far, (vec4*)m);
-#elif defined(USE_RAYMATH)
-    *((Matrix*)m) = MatrixPerspective(fovy * RAD2DEG, aspect, near, far);
-#else
-    matrix_perspective(m, fovy, aspect, near, far);
+    // Write to a temporary name and rename, so a crash never leaves a truncated entry
+    char path[PROGRAM_CACHE_PATH_SIZE];
+    char tmp_path[PROGRAM_CACHE_PATH_SIZE + 4];
+    program_cache_path(key, path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE* file = fopen(tmp_path, "wb");
+    int ok = 0;
+    if (file != NULL) {
+        ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(blob, 1, (size_t)written, file) == (size_t)written;
+        ok = (fclose(file) == 0) && ok;
+        if (ok) {
+#ifdef _WIN32
+            remove(path);
 #endif
+            ok = rename(tmp_path, path) == 0;
+        }
+        if (!ok) {
+            remove(tmp_path);
+        }
+    }
+    free(blob);
+    return ok;
 }
 
-void utils_matrix_identity(float* m) {
-#ifdef USE_CGLM
-    glm_mat4_identity((vec4*)m);
-#elif defined(USE_RAYMATH)
-    *((Matrix*)m) = MatrixIdentity();
-#else
-    matrix_identity(m);
-#endif
+// Batch shader compilation
+static int parallel_compile_state = -1;   // -1 unknown, 0 unsupported, 1 enabled
+
+// Turns on driver compile threads once per process and reports whether
+// GL_COMPLETION_STATUS_KHR can be polled without blocking
+static int parallel_compile_enable(void) {
+    if (parallel_compile_state < 0) {
+        parallel_compile_state = 0;
+        if (GLEW_KHR_parallel_shader_compile) {
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);   // let the driver pick
+            parallel_compile_state = 1;
+        } else if (GLEW_ARB_parallel_shader_compile) {
+            glMaxShaderCompilerThreadsARB(0xFFFFFFFFu);
+            parallel_compile_state = 1;
+        }
+    }
+    return parallel_compile_state;
 }
 
-// Material properties
-Material gold_material(void) {
-    Material gold = {
-        .ambient = {0.2473f, 0.1995f, 0.0745f, 1.0f},
-        .diffuse = {0.7516f, 0.6065f, 0.2265f, 1.0f},
-        .specular = {0.6283f, 0.5559f, 0.3661f, 1.0f},
-        .shininess = 51.2f
-    };
-    return gold;
+void utils_shader_batch_init(UtilsShaderBatch* batch) {
+    memset(batch, 0, sizeof(*batch));
+    batch->parallel = parallel_compile_enable();
 }
 
-Material silver_material(void) {
-    Material silver = {
-        .ambient = {0.1923f, 0.1923f, 0.1923f, 1.0f},
-        .diffuse = {0.5075f, 0.5075f, 0.5075f, 1.0f},
-        .specular = {0.5083f, 0.5083f, 0.5083f, 1.0f},
-        .shininess = 51.2f
-    };
-    return silver;
+static int shader_batch_add(UtilsShaderBatch* batch, const char* const* paths, const int* types, int count) {
+    if (batch->count >= UTILS_SHADER_BATCH_MAX) {
+        printf("Shader batch is full (%d programs)\n", UTILS_SHADER_BATCH_MAX);
+        return -1;
+    }
+    int handle = batch->count++;
+    UtilsBatchProgram* entry = &batch->programs[handle];
+    program_submit(paths, types, count, entry);
+    if (entry->status == UTILS_PROGRAM_PENDING) {
+        batch->pending++;
+    }
+    return handle;
 }
 
-Material bronze_material(void) {
-    Material bronze = {
-        .ambient = {0.2125f, 0.1275f, 0.0540f, 1.0f},
-        .diffuse = {0.7140f, 0.4284f, 0.1814f, 1.0f},
-        .specular = {0.3936f, 0.2719f, 0.1667f, 1.0f},
-        .shininess = 25.6f
-    };
-    return bronze;
+int utils_shader_batch_add(UtilsShaderBatch* batch, const char* vp, const char* fp) {
+    const char* paths[] = { vp, fp };
+    const int types[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+    return shader_batch_add(batch, paths, types, 2);
 }
 
-// Additional utility functions
-float utils_random_float(float min, float max) {
-    return min + (max - min) * ((float)rand() / RAND_MAX);
+int utils_shader_batch_add_with_geometry(UtilsShaderBatch* batch, const char* vp, const char* gp, const char* fp) {
+    const char* paths[] = { vp, gp, fp };
+    const int types[] = { GL_VERTEX_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER };
+    return shader_batch_add(batch, paths, types, 3);
 }
 
-int utils_random_int(int min, int max) {
-    return min + rand() % (max - min + 1);
+int utils_shader_batch_poll(UtilsShaderBatch* batch) {
+    for (int i = 0; i < batch->count && batch->pending > 0; i++) {
+        UtilsBatchProgram* entry = &batch->programs[i];
+        if (entry->status != UTILS_PROGRAM_PENDING) {
+            continue;
+        }
+        if (batch->parallel) {
+            int done = 0;
+            glGetProgramiv(entry->program, GL_COMPLETION_STATUS_KHR, &done);
+            if (!done) {
+                continue;
+            }
+        }
+        program_finalize(entry);
+        batch->pending--;
+        if (!batch->parallel) {
+            break;   // without the extension finalizing blocks, so spread it over calls
+        }
+    }
+    return batch->pending;
+}
+
+void utils_shader_batch_wait(UtilsShaderBatch* batch) {
+    for (int i = 0; i < batch->count; i++) {
+        if (batch->programs[i].status == UTILS_PROGRAM_PENDING) {
+            program_finalize(&batch->programs[i]);
+        }
+    }
+    batch->pending = 0;
+}
+
+UtilsProgramStatus utils_shader_batch_status(const UtilsShaderBatch* batch, int handle) {
+    if (handle < 0 || handle >= batch->count) {
+        return UTILS_PROGRAM_FAILED;
+    }
+    return batch->programs[handle].status;
+}
+
+unsigned int utils_shader_batch_program(const UtilsShaderBatch* batch, int handle) {
+    if (utils_shader_batch_status(batch, handle) != UTILS_PROGRAM_READY) {
+        return 0;
+    }
+    return batch->programs[handle].program;
+}
+
+// Uniform reflection
+static int uniform_info_compare(const void* a, const void* b) {
+    return strcmp(((const UtilsUniformInfo*)a)->name, ((const UtilsUniformInfo*)b)->name);
+}
+
+static int uniform_block_compare(const void* a, const void* b) {
+    return strcmp(((const UtilsUniformBlockInfo*)a)->name, ((const UtilsUniformBlockInfo*)b)->name);
 }
 
+int utils_uniform_table_init(UtilsUniformTable* table, unsigned int program) {
+    memset(table, 0, sizeof(*table));
+    table->program = program;
+
+    GLint linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        printf("Cannot reflect uniforms of an unlinked program %u\n", program);
+        return 0;
+    }
+
+    GLint uniform_count = 0, uniform_name_max = 0;
+    GLint block_count = 0, block_name_max = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniform_count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &uniform_name_max);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &block_count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &block_name_max);
+    if (uniform_count == 0 && block_count == 0) {
+        return 1;
+    }
+
+    // One allocation each for the entries and for every name (including terminators)
+    size_t names_size = (size_t)uniform_count * (uniform_name_max + 1) + (size_t)block_count * (block_name_max + 1);
+    table->uniforms = (UtilsUniformInfo*)malloc((size_t)uniform_count * sizeof(UtilsUniformInfo) + 1);
+    table->blocks = (UtilsUniformBlockInfo*)malloc((size_t)block_count * sizeof(UtilsUniformBlockInfo) + 1);
+    table->names = (char*)malloc(names_size + 1);
+    if (table->uniforms == NULL || table->blocks == NULL || table->names == NULL) {
+        printf("Memory allocation failed\n");
+        utils_uniform_table_free(table);
+        table->program = program;
+        return 0;
+    }
+
+    char* name = table->names;
+    for (GLint i = 0; i < uniform_count; i++) {
+        UtilsUniformInfo* info = &table->uniforms[i];
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program, (GLuint)i, uniform_name_max, &length, &size, &type, name);
+        // Arrays are reported as "name[0]"; store the plain name
+        if (length > 3 && strcmp(name + length - 3, "[0]") == 0) {
+            length -= 3;
+            name[length] = '\0';
+        }
+
+        GLuint index = (GLuint)i;
+        GLint block_index = -1;
+        glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_BLOCK_INDEX, &block_index);
+
+        info->name = name;
+        info->type = type;
+        info->size = size;
+        info->block_index = block_index;
+        info->location = block_index < 0 ? glGetUniformLocation(program, name) : -1;
+        name += length + 1;
+    }
+    table->uniform_count = uniform_count;
+
+    for (GLint i = 0; i < block_count; i++) {
+        UtilsUniformBlockInfo* info = &table->blocks[i];
+        GLsizei length = 0;
+        GLint binding = 0, data_size = 0;
+        glGetActiveUniformBlockName(program, (GLuint)i, block_name_max, &length, name);
+        glGetActiveUniformBlockiv(program, (GLuint)i, GL_UNIFORM_BLOCK_BINDING, &binding);
+        glGetActiveUniformBlockiv(program, (GLuint)i, GL_UNIFORM_BLOCK_DATA_SIZE, &data_size);
+
+        info->name = name;
+        info->index = (unsigned int)i;
+        info->binding = binding;
+        info->data_size = data_size;
+        name += length + 1;
+    }
+    table->block_count = block_count;
+
+    // Sorted by name so lookups are a binary search
+    qsort(table->uniforms, (size_t)uniform_count, sizeof(UtilsUniformInfo), uniform_info_compare);
+    qsort(table->blocks, (size_t)block_count, sizeof(UtilsUniformBlockInfo), uniform_block_compare);
+    return 1;
+}
+
+void utils_uniform_table_free(UtilsUniformTable* table) {
+    free(table->uniforms);
+    free(table->blocks);
+    free(table->names);
+    memset(table, 0, sizeof(*table));
+}
+
+const UtilsUniformInfo* utils_uniform_table_find(const UtilsUniformTable* table, const char* name) {
+    if (table->uniform_count == 0) {
+        return NULL;
+    }
+
+    // Accept "name[0]" for arrays, matching glGetUniformLocation
+    char plain[256];
+    size_t length = strlen(name);
+    if (length > 3 && length < sizeof(plain) && strcmp(name + length - 3, "[0]") == 0) {
+        memcpy(plain, name, length - 3);
+        plain[length - 3] = '\0';
+        name = plain;
+    }
+
+    UtilsUniformInfo key;
+    key.name = name;
+    return (const UtilsUniformInfo*)bsearch(&key, table->uniforms, (size_t)table->uniform_count,
+                                            sizeof(UtilsUniformInfo), uniform_info_compare);
+}
+
+int utils_uniform_location(const UtilsUniformTable* table, const char* name) {
+    const UtilsUniformInfo* info = utils_uniform_table_find(table, name);
+    if (info == NULL) {
+        printf("Uniform %s is not active in program %u\n", name, table->program);
+        return -1;
+    }
+    return info->location;
+}
+
+const UtilsUniformBlockInfo* utils_uniform_table_find_block(const UtilsUniformTable* table, const char* name) {
+    if (table->block_count == 0) {
+        return NULL;
+    }
+    UtilsUniformBlockInfo key;
+    key.name = name;
+    return (const UtilsUniformBlockInfo*)bsearch(&key, table->blocks, (size_t)table->block_count,
+                                                 sizeof(UtilsUniformBlockInfo), uniform_block_compare);
+}
+
+void utils_uniform_set_int(int location, int value) {
+    glUniform1i(location, value);
+}
+
+void utils_uniform_set_float(int location, float value) {
+    glUniform1f(location, value);
+}
+
+void utils_uniform_set_vec3(int location, const float* value) {
+    glUniform3fv(location, 1, value);
+}
+
+void utils_uniform_set_vec4(int location, const float* value) {
+    glUniform4fv(location, 1, value);
+}
+
+void utils_uniform_set_mat3(int location, const float* value) {
+    glUniformMatrix3fv(location, 1, GL_FALSE, value);
+}
+
+void utils_uniform_set_mat4(int location, const float* value) {
+    glUniformMatrix4fv(location, 1, GL_FALSE, value);
+}
+
+// Per-frame data
+unsigned int utils_frame_data_create(void) {
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    if (buffer == 0) {
+        printf("Failed to create FrameData buffer\n");
+        return 0;
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(UtilsFrameData), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UTILS_FRAME_DATA_BINDING, buffer);
+    return buffer;
+}
+
+int utils_frame_data_bind_program(unsigned int program) {
+    GLuint index = glGetUniformBlockIndex(program, UTILS_FRAME_DATA_BLOCK);
+    if (index == GL_INVALID_INDEX) {
+        return 0;
+    }
+
+    GLint size = 0;
+    glGetActiveUniformBlockiv(program, index, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+    if ((size_t)size > sizeof(UtilsFrameData)) {
+        printf("FrameData block in program %u is %d bytes, expected at most %zu\n",
+               program, size, sizeof(UtilsFrameData));
+        return 0;
+    }
+    glUniformBlockBinding(program, index, UTILS_FRAME_DATA_BINDING);
+    return 1;
+}
+
+void utils_frame_data_set(UtilsFrameData* data, const float* view, const float* projection,
+                          const float* camera_pos, float time) {
+    memcpy(data->view, view, sizeof(data->view));
+    memcpy(data->projection, projection, sizeof(data->projection));
+    utils_matrix_multiply(data->projection, data->view, data->view_projection);
+    data->camera_pos[0] = camera_pos[0];
+    data->camera_pos[1] = camera_pos[1];
+    data->camera_pos[2] = camera_pos[2];
+    data->camera_pos[3] = 1.0f;
+    data->time = time;
+}
+
+void utils_frame_data_update(unsigned int buffer, const UtilsFrameData* data) {
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(UtilsFrameData), data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+int utils_std140_validate(unsigned int program, const char* block_name,
+                          const UtilsStd140Field* fields, int field_count, size_t size) {
+    GLuint block = glGetUniformBlockIndex(program, block_name);
+    if (block == GL_INVALID_INDEX) {
+        printf("std140: block %s is not active in program %u\n", block_name, program);
+        return 0;
+    }
+
+    int valid = 1;
+    GLint block_size = 0;
+    glGetActiveUniformBlockiv(program, block, GL_UNIFORM_BLOCK_DATA_SIZE, &block_size);
+    if ((size_t)block_size > size) {
+        printf("std140: block %s is %d bytes in GLSL but %zu in C\n", block_name, block_size, size);
+        valid = 0;
+    }
+
+    for (int i = 0; i < field_count; i++) {
+        // Members of a block with an instance name are queried as "Block.member"
+        char qualified[256];
+        const char* name = fields[i].name;
+        GLuint index = GL_INVALID_INDEX;
+        glGetUniformIndices(program, 1, &name, &index);
+        if (index == GL_INVALID_INDEX) {
+            snprintf(qualified, sizeof(qualified), "%s.%s", block_name, fields[i].name);
+            name = qualified;
+            glGetUniformIndices(program, 1, &name, &index);
+        }
+        if (index == GL_INVALID_INDEX) {
+            // Inactive members are legal in std140 blocks and keep their offsets
+            continue;
+        }
+
+        GLint offset = -1;
+        glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_OFFSET, &offset);
+        if ((size_t)offset != fields[i].offset) {
+            printf("std140: %s.%s is at offset %d in GLSL but %zu in C\n",
+                   block_name, fields[i].name, offset, fields[i].offset);
+            valid = 0;
+        }
+    }
+    return valid;
+}
+#endif // USE_OPENGL
+
+// Math functions
+
+// SIMD selection for the native backend and the batch kernels. Matrices are column-major (OpenGL/cglm
+// layout), so every kernel works on whole columns: result column j is the
+// linear combination of m1's columns weighted by the entries of m2's column j.
+#if defined(__AVX__)
+#include <immintrin.h>
+#define UTILS_SIMD_AVX
+#define UTILS_SIMD_SSE
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define UTILS_SIMD_SSE
+#endif
+
+// Shared 4x4 multiply kernel, used by the native backend and by the batch API
+// regardless of which math library backs the single-matrix wrappers
+static inline void mat4_mul(const float* m1, const float* m2, float* result) {
+#if defined(UTILS_SIMD_AVX)
+    // Two result columns per iteration: each 128-bit lane holds one column of m2
+    __m256 c0 = _mm256_broadcast_ps((const __m128*)(m1 + 0));
+    __m256 c1 = _mm256_broadcast_ps((const __m128*)(m1 + 4));
+    __m256 c2 = _mm256_broadcast_ps((const __m128*)(m1 + 8));
+    __m256 c3 = _mm256_broadcast_ps((const __m128*)(m1 + 12));
+    for (int j = 0; j < 16; j += 8) {
+        __m256 b = _mm256_loadu_ps(m2 + j);
+        __m256 r = _mm256_mul_ps(c0, _mm256_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0)));
+        r = _mm256_add_ps(r, _mm256_mul_ps(c1, _mm256_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1))));
+        r = _mm256_add_ps(r, _mm256_mul_ps(c2, _mm256_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2))));
+        r = _mm256_add_ps(r, _mm256_mul_ps(c3, _mm256_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3))));
+        _mm256_storeu_ps(result + j, r);
+    }
+#elif defined(UTILS_SIMD_SSE)
+    __m128 c0 = _mm_loadu_ps(m1 + 0);
+    __m128 c1 = _mm_loadu_ps(m1 + 4);
+    __m128 c2 = _mm_loadu_ps(m1 + 8);
+    __m128 c3 = _mm_loadu_ps(m1 + 12);
+    for (int j = 0; j < 16; j += 4) {
+        __m128 b = _mm_loadu_ps(m2 + j);
+        __m128 r = _mm_mul_ps(c0, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0)));
+        r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1))));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2))));
+        r = _mm_add_ps(r, _mm_mul_ps(c3, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3))));
+        _mm_storeu_ps(result + j, r);
+    }
+#else
+    // result may alias m1 or m2, so accumulate into a temporary first
+    float tmp[16];
+    for (int j = 0; j < 4; j++) {
+        for (int i = 0; i < 4; i++) {
+            tmp[j * 4 + i] = m1[0 * 4 + i] * m2[j * 4 + 0]
+                           + m1[1 * 4 + i] * m2[j * 4 + 1]
+                           + m1[2 * 4 + i] * m2[j * 4 + 2]
+                           + m1[3 * 4 + i] * m2[j * 4 + 3];
+        }
+    }
+    memcpy(result, tmp, 16 * sizeof(float));
+#endif
+}
+
+// Trigonometry
+// Cephes-style sincos: reduce to r in [-pi/4, pi/4] with a three-part Cody-Waite
+// split of pi/4, evaluate both polynomials on r, then pick and sign them by quadrant.
+#define SINCOS_FOPI 1.27323954473516f       // 4 / pi
+#define SINCOS_DP1 0.78515625f
+#define SINCOS_DP2 2.4187564849853515625e-4f
+#define SINCOS_DP3 3.77489497744594108e-8f
+#define SINCOS_MAX_ARG 8192.0f              // beyond this the reduction loses bits
+
+static void sincos_kernel(float x, float* s, float* c, int fast) {
+    float ax = fabsf(x);
+    if (!(ax <= SINCOS_MAX_ARG)) {
+        *s = sinf(x);
+        *c = cosf(x);
+        return;
+    }
+    int j = (int)(ax * SINCOS_FOPI);
+    j = (j + 1) & ~1;
+    float y = (float)j;
+    float r = ((ax - y * SINCOS_DP1) - y * SINCOS_DP2) - y * SINCOS_DP3;
+    float z = r * r;
+    float ps, pc;
+    if (fast) {
+        ps = ((8.3333333e-3f * z - 1.6666667e-1f) * z) * r + r;
+        pc = ((-1.3888889e-3f * z + 4.1666667e-2f) * z - 0.5f) * z + 1.0f;
+    } else {
+        ps = ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f) * z * r + r;
+        pc = ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f) * z * z
+             - 0.5f * z + 1.0f;
+    }
+    int q = j >> 1;
+    float sv = (q & 1) ? pc : ps;
+    float cv = (q & 1) ? ps : pc;
+    if (q & 2) sv = -sv;
+    if ((q + 1) & 2) cv = -cv;
+    *s = signbit(x) ? -sv : sv;
+    *c = cv;
+}
+
+void utils_sincosf(float x, float* s, float* c) {
+    sincos_kernel(x, s, c, 0);
+}
+
+void utils_sincosf_fast(float x, float* s, float* c) {
+    sincos_kernel(x, s, c, 1);
+}
+
+void utils_sincos_batch(const float* x, float* s, float* c, size_t count, UtilsSincosAccuracy accuracy) {
+    int fast = accuracy == UTILS_SINCOS_FAST;
+    size_t i = 0;
+#if defined(UTILS_SIMD_SSE)
+    const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000u));
+    const __m128 max_arg = _mm_set1_ps(SINCOS_MAX_ARG);
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i two = _mm_set1_epi32(2);
+    for (; i + 4 <= count; i += 4) {
+        __m128 vx = _mm_loadu_ps(x + i);
+        __m128 ax = _mm_andnot_ps(sign_mask, vx);
+        __m128 x_sign = _mm_and_ps(vx, sign_mask);
+
+        __m128i j = _mm_cvttps_epi32(_mm_mul_ps(ax, _mm_set1_ps(SINCOS_FOPI)));
+        j = _mm_andnot_si128(one, _mm_add_epi32(j, one));
+        __m128 y = _mm_cvtepi32_ps(j);
+        __m128 r = _mm_sub_ps(ax, _mm_mul_ps(y, _mm_set1_ps(SINCOS_DP1)));
+        r = _mm_sub_ps(r, _mm_mul_ps(y, _mm_set1_ps(SINCOS_DP2)));
+        r = _mm_sub_ps(r, _mm_mul_ps(y, _mm_set1_ps(SINCOS_DP3)));
+        __m128 z = _mm_mul_ps(r, r);
+
+        __m128 ps, pc;
+        if (fast) {
+            ps = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(8.3333333e-3f), z), _mm_set1_ps(1.6666667e-1f));
+            ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, z), r), r);
+            pc = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.3888889e-3f), z), _mm_set1_ps(4.1666667e-2f));
+            pc = _mm_sub_ps(_mm_mul_ps(pc, z), _mm_set1_ps(0.5f));
+            pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(1.0f));
+        } else {
+            ps = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.9515295891e-4f), z), _mm_set1_ps(8.3321608736e-3f));
+            ps = _mm_sub_ps(_mm_mul_ps(ps, z), _mm_set1_ps(1.6666654611e-1f));
+            ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, z), r), r);
+            pc = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(2.443315711809948e-5f), z), _mm_set1_ps(1.388731625493765e-3f));
+            pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(4.166664568298827e-2f));
+            pc = _mm_mul_ps(_mm_mul_ps(pc, z), z);
+            pc = _mm_add_ps(_mm_sub_ps(pc, _mm_mul_ps(_mm_set1_ps(0.5f), z)), _mm_set1_ps(1.0f));
+        }
+
+        // Odd quadrants swap the polynomials; bit 1 of the quadrant (shifted into
+        // the sign bit) flips sin, bit 1 of quadrant + 1 flips cos
+        __m128i q = _mm_srli_epi32(j, 1);
+        __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+        __m128 sv = _mm_or_ps(_mm_and_ps(swap, pc), _mm_andnot_ps(swap, ps));
+        __m128 cv = _mm_or_ps(_mm_and_ps(swap, ps), _mm_andnot_ps(swap, pc));
+        __m128 s_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, two), 30));
+        __m128 c_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, one), two), 30));
+        sv = _mm_xor_ps(sv, _mm_xor_ps(s_sign, x_sign));
+        cv = _mm_xor_ps(cv, c_sign);
+        _mm_storeu_ps(s + i, sv);
+        _mm_storeu_ps(c + i, cv);
+
+        // Huge, infinite or NaN lanes go through libm like the scalar path
+        int out_of_range = _mm_movemask_ps(_mm_cmpnle_ps(ax, max_arg)) | _mm_movemask_ps(_mm_cmpunord_ps(ax, ax));
+        if (out_of_range) {
+            for (int k = 0; k < 4; k++) {
+                if (out_of_range & (1 << k)) {
+                    sincos_kernel(x[i + k], s + i + k, c + i + k, fast);
+                }
+            }
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        sincos_kernel(x[i], s + i, c + i, fast);
+    }
+}
+
+#if !defined(USE_CGLM) && !defined(USE_RAYMATH)
+void matrix_multiply(float* m1, float* m2, float* result) {
+    mat4_mul(m1, m2, result);
+}
+
+// m = m * T: only the fourth column changes
+void matrix_translate(float* m, float x, float y, float z) {
+#if defined(UTILS_SIMD_SSE)
+    __m128 r = _mm_loadu_ps(m + 12);
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(m + 0), _mm_set1_ps(x)));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(m + 4), _mm_set1_ps(y)));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(m + 8), _mm_set1_ps(z)));
+    _mm_storeu_ps(m + 12, r);
+#else
+    for (int i = 0; i < 4; i++) {
+        m[12 + i] += m[i] * x + m[4 + i] * y + m[8 + i] * z;
+    }
+#endif
+}
+
+// m = m * R: the fourth column is untouched, the first three are mixed by the 3x3 rotation
+void matrix_rotate(float* m, float angle, float x, float y, float z) {
+    float magnitude = sqrtf(x*x + y*y + z*z);
+    if (magnitude == 0.0f) {
+        return;
+    }
+    float s, c;
+    utils_sincosf(angle, &s, &c);
+    float nx = x / magnitude;
+    float ny = y / magnitude;
+    float nz = z / magnitude;
+    float t = 1.0f - c;
+    float r[9] = {
+        nx*nx*t+c,    ny*nx*t+nz*s, nz*nx*t-ny*s,
+        nx*ny*t-nz*s, ny*ny*t+c,    nz*ny*t+nx*s,
+        nx*nz*t+ny*s, ny*nz*t-nx*s, nz*nz*t+c
+    };
+#if defined(UTILS_SIMD_SSE)
+    __m128 c0 = _mm_loadu_ps(m + 0);
+    __m128 c1 = _mm_loadu_ps(m + 4);
+    __m128 c2 = _mm_loadu_ps(m + 8);
+    for (int j = 0; j < 3; j++) {
+        __m128 col = _mm_mul_ps(c0, _mm_set1_ps(r[j * 3 + 0]));
+        col = _mm_add_ps(col, _mm_mul_ps(c1, _mm_set1_ps(r[j * 3 + 1])));
+        col = _mm_add_ps(col, _mm_mul_ps(c2, _mm_set1_ps(r[j * 3 + 2])));
+        _mm_storeu_ps(m + j * 4, col);
+    }
+#else
+    float tmp[12];
+    for (int j = 0; j < 3; j++) {
+        for (int i = 0; i < 4; i++) {
+            tmp[j * 4 + i] = m[i] * r[j * 3 + 0] + m[4 + i] * r[j * 3 + 1] + m[8 + i] * r[j * 3 + 2];
+        }
+    }
+    memcpy(m, tmp, 12 * sizeof(float));
+#endif
+}
+
+// m = m * S: each of the first three columns is scaled independently
+void matrix_scale(float* m, float x, float y, float z) {
+#if defined(UTILS_SIMD_SSE)
+    _mm_storeu_ps(m + 0, _mm_mul_ps(_mm_loadu_ps(m + 0), _mm_set1_ps(x)));
+    _mm_storeu_ps(m + 4, _mm_mul_ps(_mm_loadu_ps(m + 4), _mm_set1_ps(y)));
+    _mm_storeu_ps(m + 8, _mm_mul_ps(_mm_loadu_ps(m + 8), _mm_set1_ps(z)));
+#else
+    for (int i = 0; i < 4; i++) {
+        m[i] *= x;
+        m[4 + i] *= y;
+        m[8 + i] *= z;
+    }
+#endif
+}
+
+void matrix_perspective(float* m, float fovy, float aspect, float near, float far) {
+    float f = 1.0f / tanf(fovy / 2.0f);
+    float nf = 1.0f / (near - far);
+
+    m[0] = f / aspect;
+    m[1] = 0.0f;
+    m[2] = 0.0f;
+    m[3] = 0.0f;
+
+    m[4] = 0.0f;
+    m[5] = f;
+    m[6] = 0.0f;
+    m[7] = 0.0f;
+
+    m[8] = 0.0f;
+    m[9] = 0.0f;
+    m[10] = (far + near) * nf;
+    m[11] = -1.0f;
+
+    m[12] = 0.0f;
+    m[13] = 0.0f;
+    m[14] = 2.0f * far * near * nf;
+    m[15] = 0.0f;
+}
+
+void matrix_identity(float* m) {
+    m[0] = 1.0f; m[4] = 0.0f; m[8] = 0.0f; m[12] = 0.0f;
+    m[1] = 0.0f; m[5] = 1.0f; m[9] = 0.0f; m[13] = 0.0f;
+    m[2] = 0.0f; m[6] = 0.0f; m[10] = 1.0f; m[14] = 0.0f;
+    m[3] = 0.0f; m[7] = 0.0f; m[11] = 0.0f; m[15] = 1.0f;
+}
+#endif // !defined(USE_CGLM) && !defined(USE_RAYMATH)
+
+// Wrapper functions for matrix operations
+void utils_matrix_multiply(float* m1, float* m2, float* result) {
+#ifdef USE_CGLM
+    glm_mat4_mul((vec4*)m1, (vec4*)m2, (vec4*)result);
+#elif defined(USE_RAYMATH)
+    *((Matrix*)result) = MatrixMultiply(*((Matrix*)m1), *((Matrix*)m2));
+#else
+    matrix_multiply(m1, m2, result);
+#endif
+}
+
+void utils_matrix_translate(float* m, float x, float y, float z) {
+#ifdef USE_CGLM
+    glm_translate((vec4*)m, (vec3){x, y, z});
+#elif defined(USE_RAYMATH)
+    *((Matrix*)m) = MatrixMultiply(*((Matrix*)m), MatrixTranslate(x, y, z));
+#else
+    matrix_translate(m, x, y, z);
+#endif
+}
+
+void utils_matrix_rotate(float* m, float angle, float x, float y, float z) {
+#ifdef USE_CGLM
+    glm_rotate((vec4*)m, angle, (vec3){x, y, z});
+#elif defined(USE_RAYMATH)
+    *((Matrix*)m) = MatrixMultiply(*((Matrix*)m), MatrixRotate((Vector3){x, y, z}, angle));
+#else
+    matrix_rotate(m, angle, x, y, z);
+#endif
+}
+
+void utils_matrix_scale(float* m, float x, float y, float z) {
+#ifdef USE_CGLM
+    glm_scale((vec4*)m, (vec3){x, y, z});
+#elif defined(USE_RAYMATH)
+    *((Matrix*)m) = MatrixMultiply(*((Matrix*)m), MatrixScale(x, y, z));
+#else
+    matrix_scale(m, x, y, z);
+#endif
+}
+
+void utils_matrix_perspective(float* m, float fovy, float aspect, float near, float far) {
+#ifdef USE_CGLM
+    glm_perspective(fovy, aspect, near, far, (vec4*)m);
+#elif defined(USE_RAYMATH)
+    *((Matrix*)m) = MatrixPerspective(fovy * RAD2DEG, aspect, near, far);
+#else
+    matrix_perspective(m, fovy, aspect, near, far);
+#endif
+}
+
+void utils_matrix_identity(float* m) {
+#ifdef USE_CGLM
+    glm_mat4_identity((vec4*)m);
+#elif defined(USE_RAYMATH)
+    *((Matrix*)m) = MatrixIdentity();
+#else
+    matrix_identity(m);
+#endif
+}
+
+// Batched matrix operations
+void* utils_aligned_alloc(size_t alignment, size_t size) {
+#if defined(_WIN32)
+    return _aligned_malloc(size, alignment);
+#else
+    void* ptr = NULL;
+    if (posix_memalign(&ptr, alignment, size) != 0) {
+        return NULL;
+    }
+    return ptr;
+#endif
+}
+
+void utils_aligned_free(void* ptr) {
+#if defined(_WIN32)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+// Cofactor inverse written once for any lane type: s and d are 16 column-major
+// elements, each either a float (one matrix) or a SIMD register (one matrix per lane)
+#define UTILS_MAT4_INVERT_LANES(T, s, d, ADD, SUB, MUL, RCP, NEG) do {                  \
+    T c1  = SUB(MUL(s[10], s[15]), MUL(s[11], s[14]));                                   \
+    T c2  = SUB(MUL(s[2],  s[7]),  MUL(s[3],  s[6]));                                    \
+    T c3  = SUB(MUL(s[8],  s[15]), MUL(s[11], s[12]));                                   \
+    T c4  = SUB(MUL(s[0],  s[7]),  MUL(s[3],  s[4]));                                    \
+    T c5  = SUB(MUL(s[9],  s[15]), MUL(s[11], s[13]));                                   \
+    T c6  = SUB(MUL(s[1],  s[7]),  MUL(s[3],  s[5]));                                    \
+    T c7  = SUB(MUL(s[8],  s[13]), MUL(s[9],  s[12]));                                   \
+    T c8  = SUB(MUL(s[0],  s[5]),  MUL(s[1],  s[4]));                                    \
+    T c9  = SUB(MUL(s[9],  s[14]), MUL(s[10], s[13]));                                   \
+    T c10 = SUB(MUL(s[1],  s[6]),  MUL(s[2],  s[5]));                                    \
+    T c11 = SUB(MUL(s[8],  s[14]), MUL(s[10], s[12]));                                   \
+    T c12 = SUB(MUL(s[0],  s[6]),  MUL(s[2],  s[4]));                                    \
+    T det = ADD(ADD(ADD(MUL(c8, c1), MUL(c4, c9)), ADD(MUL(c10, c3), MUL(c2, c7))),     \
+                NEG(ADD(MUL(c12, c5), MUL(c6, c11))));                                   \
+    T idt = RCP(det);                                                                     \
+    T ndt = NEG(idt);                                                                     \
+    T r[16];                                                                              \
+    r[0]  = MUL(ADD(SUB(MUL(s[5],  c1),  MUL(s[6],  c5)),  MUL(s[7],  c9)),  idt);       \
+    r[1]  = MUL(ADD(SUB(MUL(s[1],  c1),  MUL(s[2],  c5)),  MUL(s[3],  c9)),  ndt);       \
+    r[2]  = MUL(ADD(SUB(MUL(s[13], c2),  MUL(s[14], c6)),  MUL(s[15], c10)), idt);       \
+    r[3]  = MUL(ADD(SUB(MUL(s[9],  c2),  MUL(s[10], c6)),  MUL(s[11], c10)), ndt);       \
+    r[4]  = MUL(ADD(SUB(MUL(s[4],  c1),  MUL(s[6],  c3)),  MUL(s[7],  c11)), ndt);       \
+    r[5]  = MUL(ADD(SUB(MUL(s[0],  c1),  MUL(s[2],  c3)),  MUL(s[3],  c11)), idt);       \
+    r[6]  = MUL(ADD(SUB(MUL(s[12], c2),  MUL(s[14], c4)),  MUL(s[15], c12)), ndt);       \
+    r[7]  = MUL(ADD(SUB(MUL(s[8],  c2),  MUL(s[10], c4)),  MUL(s[11], c12)), idt);       \
+    r[8]  = MUL(ADD(SUB(MUL(s[4],  c5),  MUL(s[5],  c3)),  MUL(s[7],  c7)),  idt);       \
+    r[9]  = MUL(ADD(SUB(MUL(s[0],  c5),  MUL(s[1],  c3)),  MUL(s[3],  c7)),  ndt);       \
+    r[10] = MUL(ADD(SUB(MUL(s[12], c6),  MUL(s[13], c4)),  MUL(s[15], c8)),  idt);       \
+    r[11] = MUL(ADD(SUB(MUL(s[8],  c6),  MUL(s[9],  c4)),  MUL(s[11], c8)),  ndt);       \
+    r[12] = MUL(ADD(SUB(MUL(s[4],  c9),  MUL(s[5],  c11)), MUL(s[6],  c7)),  ndt);       \
+    r[13] = MUL(ADD(SUB(MUL(s[0],  c9),  MUL(s[1],  c11)), MUL(s[2],  c7)),  idt);       \
+    r[14] = MUL(ADD(SUB(MUL(s[12], c10), MUL(s[13], c12)), MUL(s[14], c8)),  ndt);       \
+    r[15] = MUL(ADD(SUB(MUL(s[8],  c10), MUL(s[9],  c12)), MUL(s[10], c8)),  idt);       \
+    for (int e_ = 0; e_ < 16; e_++) d[e_] = r[e_];                                        \
+} while (0)
+
+#define UTILS_F_ADD(a, b) ((a) + (b))
+#define UTILS_F_SUB(a, b) ((a) - (b))
+#define UTILS_F_MUL(a, b) ((a) * (b))
+#define UTILS_F_RCP(a) (1.0f / (a))
+#define UTILS_F_NEG(a) (-(a))
+
+#if defined(UTILS_SIMD_SSE)
+#define UTILS_V_RCP(a) _mm_div_ps(_mm_set1_ps(1.0f), (a))
+#define UTILS_V_NEG(a) _mm_sub_ps(_mm_setzero_ps(), (a))
+#endif
+
+static void mat4_invert_scalar(const float* m, float* result) {
+    float s[16];
+    memcpy(s, m, sizeof(s));
+    UTILS_MAT4_INVERT_LANES(float, s, result, UTILS_F_ADD, UTILS_F_SUB, UTILS_F_MUL, UTILS_F_RCP, UTILS_F_NEG);
+}
+
+// Kernels operate on [begin, end) so the dispatcher can split a batch across threads
+typedef struct {
+    const float* a;
+    const float* b;
+    float* result;
+    const UtilsMat4SoA* soa_a;
+    const UtilsMat4SoA* soa_b;
+    const UtilsMat4SoA* soa_result;
+} BatchArgs;
+
+typedef void (*BatchKernel)(const BatchArgs* args, size_t begin, size_t end);
+
+static void kernel_multiply(const BatchArgs* args, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        mat4_mul(args->a + i * 16, args->b + i * 16, args->result + i * 16);
+    }
+}
+
+static void kernel_multiply_left(const BatchArgs* args, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        mat4_mul(args->a, args->b + i * 16, args->result + i * 16);
+    }
+}
+
+static void kernel_transform_points(const BatchArgs* args, size_t begin, size_t end) {
+    const float* m = args->a;
+#if defined(UTILS_SIMD_SSE)
+    __m128 c0 = _mm_loadu_ps(m + 0);
+    __m128 c1 = _mm_loadu_ps(m + 4);
+    __m128 c2 = _mm_loadu_ps(m + 8);
+    __m128 c3 = _mm_loadu_ps(m + 12);
+    for (size_t i = begin; i < end; i++) {
+        __m128 p = _mm_loadu_ps(args->b + i * 4);
+        __m128 r = _mm_mul_ps(c0, _mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 0, 0, 0)));
+        r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1))));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2))));
+        r = _mm_add_ps(r, _mm_mul_ps(c3, _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 3, 3))));
+        _mm_storeu_ps(args->result + i * 4, r);
+    }
+#else
+    for (size_t i = begin; i < end; i++) {
+        const float* p = args->b + i * 4;
+        float r[4];
+        for (int k = 0; k < 4; k++) {
+            r[k] = m[k] * p[0] + m[4 + k] * p[1] + m[8 + k] * p[2] + m[12 + k] * p[3];
+        }
+        memcpy(args->result + i * 4, r, sizeof(r));
+    }
+#endif
+}
+
+static void kernel_invert(const BatchArgs* args, size_t begin, size_t end) {
+    size_t i = begin;
+#if defined(UTILS_SIMD_SSE)
+    // Transpose four AoS matrices into SoA registers, invert lane-wise, transpose back
+    for (; i + 4 <= end; i += 4) {
+        const float* m = args->a + i * 16;
+        __m128 s[16];
+        for (int e = 0; e < 16; e += 4) {
+            __m128 r0 = _mm_loadu_ps(m + 0 * 16 + e);
+            __m128 r1 = _mm_loadu_ps(m + 1 * 16 + e);
+            __m128 r2 = _mm_loadu_ps(m + 2 * 16 + e);
+            __m128 r3 = _mm_loadu_ps(m + 3 * 16 + e);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            s[e + 0] = r0; s[e + 1] = r1; s[e + 2] = r2; s[e + 3] = r3;
+        }
+        __m128 d[16];
+        UTILS_MAT4_INVERT_LANES(__m128, s, d, _mm_add_ps, _mm_sub_ps, _mm_mul_ps, UTILS_V_RCP, UTILS_V_NEG);
+        float* out = args->result + i * 16;
+        for (int e = 0; e < 16; e += 4) {
+            __m128 r0 = d[e + 0], r1 = d[e + 1], r2 = d[e + 2], r3 = d[e + 3];
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps(out + 0 * 16 + e, r0);
+            _mm_storeu_ps(out + 1 * 16 + e, r1);
+            _mm_storeu_ps(out + 2 * 16 + e, r2);
+            _mm_storeu_ps(out + 3 * 16 + e, r3);
+        }
+    }
+#endif
+    for (; i < end; i++) {
+        mat4_invert_scalar(args->a + i * 16, args->result + i * 16);
+    }
+}
+
+static void kernel_multiply_soa(const BatchArgs* args, size_t begin, size_t end) {
+    float* const* a = args->soa_a->m;
+    float* const* b = args->soa_b->m;
+    float* const* r = args->soa_result->m;
+    size_t i = begin;
+#if defined(UTILS_SIMD_AVX)
+    for (; i + 8 <= end; i += 8) {
+        __m256 out[16];
+        for (int col = 0; col < 4; col++) {
+            __m256 b0 = _mm256_loadu_ps(b[col * 4 + 0] + i);
+            __m256 b1 = _mm256_loadu_ps(b[col * 4 + 1] + i);
+            __m256 b2 = _mm256_loadu_ps(b[col * 4 + 2] + i);
+            __m256 b3 = _mm256_loadu_ps(b[col * 4 + 3] + i);
+            for (int row = 0; row < 4; row++) {
+                __m256 v = _mm256_mul_ps(_mm256_loadu_ps(a[0 * 4 + row] + i), b0);
+                v = _mm256_add_ps(v, _mm256_mul_ps(_mm256_loadu_ps(a[1 * 4 + row] + i), b1));
+                v = _mm256_add_ps(v, _mm256_mul_ps(_mm256_loadu_ps(a[2 * 4 + row] + i), b2));
+                v = _mm256_add_ps(v, _mm256_mul_ps(_mm256_loadu_ps(a[3 * 4 + row] + i), b3));
+                out[col * 4 + row] = v;
+            }
+        }
+        for (int e = 0; e < 16; e++) _mm256_storeu_ps(r[e] + i, out[e]);
+    }
+#endif
+#if defined(UTILS_SIMD_SSE)
+    for (; i + 4 <= end; i += 4) {
+        __m128 out[16];
+        for (int col = 0; col < 4; col++) {
+            __m128 b0 = _mm_loadu_ps(b[col * 4 + 0] + i);
+            __m128 b1 = _mm_loadu_ps(b[col * 4 + 1] + i);
+            __m128 b2 = _mm_loadu_ps(b[col * 4 + 2] + i);
+            __m128 b3 = _mm_loadu_ps(b[col * 4 + 3] + i);
+            for (int row = 0; row < 4; row++) {
+                __m128 v = _mm_mul_ps(_mm_loadu_ps(a[0 * 4 + row] + i), b0);
+                v = _mm_add_ps(v, _mm_mul_ps(_mm_loadu_ps(a[1 * 4 + row] + i), b1));
+                v = _mm_add_ps(v, _mm_mul_ps(_mm_loadu_ps(a[2 * 4 + row] + i), b2));
+                v = _mm_add_ps(v, _mm_mul_ps(_mm_loadu_ps(a[3 * 4 + row] + i), b3));
+                out[col * 4 + row] = v;
+            }
+        }
+        for (int e = 0; e < 16; e++) _mm_storeu_ps(r[e] + i, out[e]);
+    }
+#endif
+    for (; i < end; i++) {
+        float ma[16], mb[16], mr[16];
+        for (int e = 0; e < 16; e++) {
+            ma[e] = a[e][i];
+            mb[e] = b[e][i];
+        }
+        mat4_mul(ma, mb, mr);
+        for (int e = 0; e < 16; e++) r[e][i] = mr[e];
+    }
+}
+
+static void kernel_invert_soa(const BatchArgs* args, size_t begin, size_t end) {
+    float* const* a = args->soa_a->m;
+    float* const* r = args->soa_result->m;
+    size_t i = begin;
+#if defined(UTILS_SIMD_SSE)
+    for (; i + 4 <= end; i += 4) {
+        __m128 s[16], d[16];
+        for (int e = 0; e < 16; e++) s[e] = _mm_loadu_ps(a[e] + i);
+        UTILS_MAT4_INVERT_LANES(__m128, s, d, _mm_add_ps, _mm_sub_ps, _mm_mul_ps, UTILS_V_RCP, UTILS_V_NEG);
+        for (int e = 0; e < 16; e++) _mm_storeu_ps(r[e] + i, d[e]);
+    }
+#endif
+    for (; i < end; i++) {
+        float m[16], inv[16];
+        for (int e = 0; e < 16; e++) m[e] = a[e][i];
+        mat4_invert_scalar(m, inv);
+        for (int e = 0; e < 16; e++) r[e][i] = inv[e];
+    }
+}
+
+static int batch_thread_count = 0;  // 0 = one per online CPU
+
+void utils_set_batch_threads(int count) {
+    batch_thread_count = count;
+}
+
+#if defined(UTILS_BATCH_THREADS)
+#define UTILS_MAX_BATCH_THREADS 16
+
+typedef struct {
+    BatchKernel kernel;
+    const BatchArgs* args;
+    size_t begin;
+    size_t end;
+} BatchJob;
+
+static void* batch_worker(void* data) {
+    BatchJob* job = (BatchJob*)data;
+    job->kernel(job->args, job->begin, job->end);
+    return NULL;
+}
+#endif
+
+static void batch_dispatch(BatchKernel kernel, const BatchArgs* args, size_t count) {
+#if defined(UTILS_BATCH_THREADS)
+    int threads = batch_thread_count;
+    if (threads <= 0) {
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (threads > UTILS_MAX_BATCH_THREADS) threads = UTILS_MAX_BATCH_THREADS;
+    if (count >= UTILS_BATCH_THREAD_THRESHOLD && threads > 1) {
+        BatchJob jobs[UTILS_MAX_BATCH_THREADS];
+        pthread_t workers[UTILS_MAX_BATCH_THREADS];
+        int started[UTILS_MAX_BATCH_THREADS] = {0};
+        // Chunks are multiples of 8 so every thread stays on the SIMD path
+        size_t chunk = ((count / threads) + 7) & ~(size_t)7;
+        for (int t = 0; t < threads; t++) {
+            jobs[t].kernel = kernel;
+            jobs[t].args = args;
+            jobs[t].begin = (size_t)t * chunk < count ? (size_t)t * chunk : count;
+            jobs[t].end = jobs[t].begin + chunk < count ? jobs[t].begin + chunk : count;
+        }
+        // The calling thread takes the first chunk; if a worker fails to start its chunk runs inline
+        for (int t = 1; t < threads; t++) {
+            started[t] = pthread_create(&workers[t], NULL, batch_worker, &jobs[t]) == 0;
+        }
+        kernel(args, jobs[0].begin, jobs[0].end);
+        for (int t = 1; t < threads; t++) {
+            if (started[t]) {
+                pthread_join(workers[t], NULL);
+            } else {
+                kernel(args, jobs[t].begin, jobs[t].end);
+            }
+        }
+        return;
+    }
+#endif
+    kernel(args, 0, count);
+}
+
+void utils_matrix_multiply_batch(const float* a, const float* b, float* result, size_t count) {
+    BatchArgs args = { .a = a, .b = b, .result = result };
+    batch_dispatch(kernel_multiply, &args, count);
+}
+
+void utils_matrix_multiply_batch_left(const float* m, const float* b, float* result, size_t count) {
+    BatchArgs args = { .a = m, .b = b, .result = result };
+    batch_dispatch(kernel_multiply_left, &args, count);
+}
+
+void utils_matrix_transform_points_batch(const float* m, const float* points, float* result, size_t count) {
+    BatchArgs args = { .a = m, .b = points, .result = result };
+    batch_dispatch(kernel_transform_points, &args, count);
+}
+
+void utils_matrix_invert_batch(const float* m, float* result, size_t count) {
+    BatchArgs args = { .a = m, .result = result };
+    batch_dispatch(kernel_invert, &args, count);
+}
+
+void utils_matrix_multiply_batch_soa(const UtilsMat4SoA* a, const UtilsMat4SoA* b, UtilsMat4SoA* result) {
+    BatchArgs args = { .soa_a = a, .soa_b = b, .soa_result = result };
+    batch_dispatch(kernel_multiply_soa, &args, result->count);
+}
+
+void utils_matrix_invert_batch_soa(const UtilsMat4SoA* m, UtilsMat4SoA* result) {
+    BatchArgs args = { .soa_a = m, .soa_result = result };
+    batch_dispatch(kernel_invert_soa, &args, result->count);
+}
+
+// Affine transforms
+void utils_affine_identity(UtilsAffine* a) {
+    static const float identity[12] = {
+        1.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 1.0f,
+        0.0f, 0.0f, 0.0f
+    };
+    memcpy(a->m, identity, sizeof(identity));
+}
+
+void utils_affine_from_mat4(const float* m, UtilsAffine* out) {
+    for (int j = 0; j < 4; j++) {
+        out->m[j * 3 + 0] = m[j * 4 + 0];
+        out->m[j * 3 + 1] = m[j * 4 + 1];
+        out->m[j * 3 + 2] = m[j * 4 + 2];
+    }
+}
+
+void utils_affine_to_mat4(const UtilsAffine* a, float* m) {
+    for (int j = 0; j < 4; j++) {
+        m[j * 4 + 0] = a->m[j * 3 + 0];
+        m[j * 4 + 1] = a->m[j * 3 + 1];
+        m[j * 4 + 2] = a->m[j * 3 + 2];
+        m[j * 4 + 3] = 0.0f;
+    }
+    m[15] = 1.0f;
+}
+
+void utils_affine_compose(const UtilsAffine* a, const UtilsAffine* b, UtilsAffine* out) {
+    const float* x = a->m;
+    const float* y = b->m;
+    float r[12];
+    for (int j = 0; j < 4; j++) {
+        for (int i = 0; i < 3; i++) {
+            r[j * 3 + i] = x[i] * y[j * 3 + 0] + x[3 + i] * y[j * 3 + 1] + x[6 + i] * y[j * 3 + 2];
+        }
+    }
+    // The translation column also picks up a's translation (implicit w = 1)
+    r[9]  += x[9];
+    r[10] += x[10];
+    r[11] += x[11];
+    memcpy(out->m, r, sizeof(r));
+}
+
+void utils_affine_premultiply_mat4(const float* m, const UtilsAffine* a, float* result) {
+    float r[16];
+    for (int j = 0; j < 4; j++) {
+        for (int i = 0; i < 4; i++) {
+            r[j * 4 + i] = m[i] * a->m[j * 3 + 0] + m[4 + i] * a->m[j * 3 + 1] + m[8 + i] * a->m[j * 3 + 2];
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        r[12 + i] += m[12 + i];
+    }
+    memcpy(result, r, sizeof(r));
+}
+
+void utils_affine_translate(UtilsAffine* a, float x, float y, float z) {
+    float* m = a->m;
+    for (int i = 0; i < 3; i++) {
+        m[9 + i] += m[i] * x + m[3 + i] * y + m[6 + i] * z;
+    }
+}
+
+void utils_affine_rotate(UtilsAffine* a, float angle, float x, float y, float z) {
+    float magnitude = sqrtf(x*x + y*y + z*z);
+    if (magnitude == 0.0f) {
+        return;
+    }
+    float s, c;
+    utils_sincosf(angle, &s, &c);
+    float nx = x / magnitude;
+    float ny = y / magnitude;
+    float nz = z / magnitude;
+    float t = 1.0f - c;
+    UtilsAffine rotation = {{
+        nx*nx*t+c,    ny*nx*t+nz*s, nz*nx*t-ny*s,
+        nx*ny*t-nz*s, ny*ny*t+c,    nz*ny*t+nx*s,
+        nx*nz*t+ny*s, ny*nz*t-nx*s, nz*nz*t+c,
+        0.0f,         0.0f,         0.0f
+    }};
+    utils_affine_compose(a, &rotation, a);
+}
+
+void utils_affine_scale(UtilsAffine* a, float x, float y, float z) {
+    float* m = a->m;
+    for (int i = 0; i < 3; i++) {
+        m[i] *= x;
+        m[3 + i] *= y;
+        m[6 + i] *= z;
+    }
+}
+
+// Cofactors of the upper 3x3, laid out as the transposed inverse (unscaled)
+static float affine_cofactors(const float* m, float* cof) {
+    cof[0] = m[4] * m[8] - m[5] * m[7];
+    cof[1] = m[5] * m[6] - m[3] * m[8];
+    cof[2] = m[3] * m[7] - m[4] * m[6];
+    cof[3] = m[2] * m[7] - m[1] * m[8];
+    cof[4] = m[0] * m[8] - m[2] * m[6];
+    cof[5] = m[1] * m[6] - m[0] * m[7];
+    cof[6] = m[1] * m[5] - m[2] * m[4];
+    cof[7] = m[2] * m[3] - m[0] * m[5];
+    cof[8] = m[0] * m[4] - m[1] * m[3];
+    return m[0] * cof[0] + m[1] * cof[1] + m[2] * cof[2];
+}
+
+int utils_affine_inverse(const UtilsAffine* a, UtilsAffine* out) {
+    float cof[9];
+    float det = affine_cofactors(a->m, cof);
+    if (det == 0.0f) {
+        return 0;
+    }
+    float inv_det = 1.0f / det;
+    float r[12];
+    // inverse(B) = transpose(cofactors) / det
+    for (int j = 0; j < 3; j++) {
+        for (int i = 0; i < 3; i++) {
+            r[j * 3 + i] = cof[i * 3 + j] * inv_det;
+        }
+    }
+    const float* t = a->m + 9;
+    for (int i = 0; i < 3; i++) {
+        r[9 + i] = -(r[i] * t[0] + r[3 + i] * t[1] + r[6 + i] * t[2]);
+    }
+    memcpy(out->m, r, sizeof(r));
+    return 1;
+}
+
+void utils_affine_inverse_rigid(const UtilsAffine* a, UtilsAffine* out) {
+    const float* m = a->m;
+    float r[12] = {
+        m[0], m[3], m[6],
+        m[1], m[4], m[7],
+        m[2], m[5], m[8],
+        0.0f, 0.0f, 0.0f
+    };
+    r[9]  = -(m[0] * m[9] + m[1] * m[10] + m[2] * m[11]);
+    r[10] = -(m[3] * m[9] + m[4] * m[10] + m[5] * m[11]);
+    r[11] = -(m[6] * m[9] + m[7] * m[10] + m[8] * m[11]);
+    memcpy(out->m, r, sizeof(r));
+}
+
+int utils_affine_normal_matrix(const UtilsAffine* a, float* out) {
+    float cof[9];
+    float det = affine_cofactors(a->m, cof);
+    if (det == 0.0f) {
+        return 0;
+    }
+    float inv_det = 1.0f / det;
+    for (int i = 0; i < 9; i++) {
+        out[i] = cof[i] * inv_det;
+    }
+    return 1;
+}
+
+// Material properties
+Material gold_material(void) {
+    Material gold = {
+        .ambient = {0.2473f, 0.1995f, 0.0745f, 1.0f},
+        .diffuse = {0.7516f, 0.6065f, 0.2265f, 1.0f},
+        .specular = {0.6283f, 0.5559f, 0.3661f, 1.0f},
+        .shininess = 51.2f
+    };
+    return gold;
+}
+
+Material silver_material(void) {
+    Material silver = {
+        .ambient = {0.1923f, 0.1923f, 0.1923f, 1.0f},
+        .diffuse = {0.5075f, 0.5075f, 0.5075f, 1.0f},
+        .specular = {0.5083f, 0.5083f, 0.5083f, 1.0f},
+        .shininess = 51.2f
+    };
+    return silver;
+}
+
+Material bronze_material(void) {
+    Material bronze = {
+        .ambient = {0.2125f, 0.1275f, 0.0540f, 1.0f},
+        .diffuse = {0.7140f, 0.4284f, 0.1814f, 1.0f},
+        .specular = {0.3936f, 0.2719f, 0.1667f, 1.0f},
+        .shininess = 25.6f
+    };
+    return bronze;
+}
+
+// Random numbers
+static inline uint32_t rng_rotl(uint32_t x, int k) {
+    return (x << k) | (x >> (32 - k));
+}
+
+static uint64_t splitmix64(uint64_t* x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+void utils_rng_seed(UtilsRng* rng, uint64_t seed) {
+    uint64_t a = splitmix64(&seed);
+    uint64_t b = splitmix64(&seed);
+    rng->s[0] = (uint32_t)a;
+    rng->s[1] = (uint32_t)(a >> 32);
+    rng->s[2] = (uint32_t)b;
+    rng->s[3] = (uint32_t)(b >> 32);
+    if ((rng->s[0] | rng->s[1] | rng->s[2] | rng->s[3]) == 0) {
+        rng->s[0] = 1;  // the all-zero state never leaves zero
+    }
+}
+
+uint32_t utils_rng_next(UtilsRng* rng) {
+    uint32_t* s = rng->s;
+    uint32_t result = s[0] + s[3];
+    uint32_t t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rng_rotl(s[3], 11);
+    return result;
+}
+
+// The low bits of xoshiro128+ are weak, so floats are built from the top 24 bits
+static inline float rng_unit_float(uint32_t x) {
+    return (float)(x >> 8) * (1.0f / 16777216.0f);
+}
+
+// Lemire's nearly divisionless bounded draw: maps x onto [0, range) and rejects the
+// few values that would bias the result. range 0 stands for the full 2^32.
+static uint32_t rng_bounded(UtilsRng* rng, uint32_t x, uint32_t range) {
+    if (range == 0) {
+        return x;
+    }
+    uint64_t m = (uint64_t)x * range;
+    uint32_t low = (uint32_t)m;
+    if (low < range) {
+        uint32_t threshold = (0u - range) % range;
+        while (low < threshold) {
+            m = (uint64_t)utils_rng_next(rng) * range;
+            low = (uint32_t)m;
+        }
+    }
+    return (uint32_t)(m >> 32);
+}
+
+// Largest result that keeps the range half-open: min + span * u can round up to max when
+// u is close to 1 or the span is large. Reversed ranges are left alone.
+static inline float rng_float_top(float min, float max) {
+    return min < max ? nextafterf(max, min) : INFINITY;
+}
+
+float utils_rng_float(UtilsRng* rng, float min, float max) {
+    float value = min + (max - min) * rng_unit_float(utils_rng_next(rng));
+    float top = rng_float_top(min, max);
+    return value > top ? top : value;
+}
+
+int utils_rng_int(UtilsRng* rng, int min, int max) {
+    uint32_t range = (uint32_t)max - (uint32_t)min + 1u;
+    return (int)((uint32_t)min + rng_bounded(rng, utils_rng_next(rng), range));
+}
+
+#if defined(UTILS_SIMD_SSE)
+// Four independent xoshiro128+ streams, one per lane, seeded from the scalar generator
+typedef struct {
+    __m128i s0, s1, s2, s3;
+} RngLanes;
+
+static void rng_lanes_init(UtilsRng* rng, RngLanes* lanes) {
+    uint32_t v[16];
+    for (int i = 0; i < 16; i++) {
+        v[i] = utils_rng_next(rng);
+    }
+    for (int lane = 0; lane < 4; lane++) {
+        if ((v[lane] | v[lane + 4] | v[lane + 8] | v[lane + 12]) == 0) {
+            v[lane] = 1;
+        }
+    }
+    lanes->s0 = _mm_loadu_si128((const __m128i*)(v + 0));
+    lanes->s1 = _mm_loadu_si128((const __m128i*)(v + 4));
+    lanes->s2 = _mm_loadu_si128((const __m128i*)(v + 8));
+    lanes->s3 = _mm_loadu_si128((const __m128i*)(v + 12));
+}
+
+static inline __m128i rng_lanes_next(RngLanes* l) {
+    __m128i result = _mm_add_epi32(l->s0, l->s3);
+    __m128i t = _mm_slli_epi32(l->s1, 9);
+    l->s2 = _mm_xor_si128(l->s2, l->s0);
+    l->s3 = _mm_xor_si128(l->s3, l->s1);
+    l->s1 = _mm_xor_si128(l->s1, l->s2);
+    l->s0 = _mm_xor_si128(l->s0, l->s3);
+    l->s2 = _mm_xor_si128(l->s2, t);
+    l->s3 = _mm_or_si128(_mm_slli_epi32(l->s3, 11), _mm_srli_epi32(l->s3, 21));
+    return result;
+}
+#endif
+
+void utils_rng_fill_floats(UtilsRng* rng, float* out, size_t count, float min, float max) {
+    size_t i = 0;
+    float span = max - min;
+    float top = rng_float_top(min, max);
+#if defined(UTILS_SIMD_SSE)
+    if (count >= 16) {
+        RngLanes lanes;
+        rng_lanes_init(rng, &lanes);
+        __m128 scale = _mm_set1_ps(span * (1.0f / 16777216.0f));
+        __m128 offset = _mm_set1_ps(min);
+        __m128 limit = _mm_set1_ps(top);
+        for (; i + 4 <= count; i += 4) {
+            __m128i bits = _mm_srli_epi32(rng_lanes_next(&lanes), 8);
+            __m128 f = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(bits), scale), offset);
+            _mm_storeu_ps(out + i, _mm_min_ps(f, limit));
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        float value = min + span * rng_unit_float(utils_rng_next(rng));
+        out[i] = value > top ? top : value;
+    }
+}
+
+void utils_rng_fill_ints(UtilsRng* rng, int* out, size_t count, int min, int max) {
+    uint32_t* raw = (uint32_t*)out;
+    size_t i = 0;
+    // Raw bits first (vectorized), then a scalar bounded pass that rarely has to redraw
+#if defined(UTILS_SIMD_SSE)
+    if (count >= 16) {
+        RngLanes lanes;
+        rng_lanes_init(rng, &lanes);
+        for (; i + 4 <= count; i += 4) {
+            _mm_storeu_si128((__m128i*)(raw + i), rng_lanes_next(&lanes));
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        raw[i] = utils_rng_next(rng);
+    }
+    uint32_t range = (uint32_t)max - (uint32_t)min + 1u;
+    for (i = 0; i < count; i++) {
+        raw[i] = (uint32_t)min + rng_bounded(rng, raw[i], range);
+    }
+}
+
+static UTILS_THREAD_LOCAL UtilsRng thread_rng;
+static UTILS_THREAD_LOCAL int thread_rng_seeded = 0;
+
+UtilsRng* utils_random_rng(void) {
+    if (!thread_rng_seeded) {
+        // Each thread's generator lives at a different address, which keeps
+        // threads that start in the same second on different sequences
+        uint64_t seed = ((uint64_t)time(NULL) << 32) ^ (uint64_t)(uintptr_t)&thread_rng;
+        utils_rng_seed(&thread_rng, seed);
+        thread_rng_seeded = 1;
+    }
+    return &thread_rng;
+}
+
+void utils_random_seed(uint64_t seed) {
+    utils_rng_seed(&thread_rng, seed);
+    thread_rng_seeded = 1;
+}
+
+float utils_random_float(float min, float max) {
+    return utils_rng_float(utils_random_rng(), min, max);
+}
+
+int utils_random_int(int min, int max) {
+    return utils_rng_int(utils_random_rng(), min, max);
+}
+
+// Mesh optimization
+void utils_mesh_analyze_vertex_cache(const unsigned int* indices, size_t index_count, size_t vertex_count,
+                                     int cache_size, UtilsVertexCacheStats* out_stats) {
+    out_stats->acmr = 0.0f;
+    out_stats->atvr = 0.0f;
+    if (index_count < 3 || vertex_count == 0) {
+        return;
+    }
+
+    // A vertex is in the FIFO if it was pushed less than cache_size misses ago
+    size_t* pushed_at = (size_t*)malloc(vertex_count * sizeof(size_t));
+    unsigned char* used = (unsigned char*)calloc(vertex_count, 1);
+    if (!pushed_at || !used) {
+        free(pushed_at);
+        free(used);
+        return;
+    }
+
+    size_t misses = 0;
+    size_t referenced = 0;
+    for (size_t i = 0; i < index_count; i++) {
+        unsigned int v = indices[i];
+        if (!used[v]) {
+            used[v] = 1;
+            referenced++;
+        } else if (misses - pushed_at[v] < (size_t)cache_size) {
+            continue;
+        }
+        pushed_at[v] = misses++;
+    }
+
+    out_stats->acmr = (float)misses / (float)(index_count / 3);
+    out_stats->atvr = (float)misses / (float)referenced;
+    free(pushed_at);
+    free(used);
+}
+
+// FNV-1a over the vertex bytes; fnv1a64 above only exists in USE_OPENGL builds
+static uint32_t mesh_vertex_hash(const float* v, size_t bytes) {
+    const unsigned char* p = (const unsigned char*)v;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < bytes; i++) {
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+size_t utils_mesh_weld(const float* vertices, size_t vertex_count, size_t stride, unsigned int* out_remap) {
+    size_t capacity = 16;
+    while (capacity < vertex_count * 2) {
+        capacity *= 2;
+    }
+    unsigned int* table = (unsigned int*)malloc(capacity * sizeof(unsigned int));
+    unsigned int* first = (unsigned int*)malloc(vertex_count * sizeof(unsigned int));
+    if (!table || !first) {
+        free(table);
+        free(first);
+        return 0;
+    }
+    memset(table, 0xFF, capacity * sizeof(unsigned int));
+
+    // Open addressing on the vertex bytes; slots hold the first input vertex of each group
+    size_t bytes = stride * sizeof(float);
+    size_t unique = 0;
+    for (size_t i = 0; i < vertex_count; i++) {
+        const float* v = vertices + i * stride;
+        size_t slot = mesh_vertex_hash(v, bytes) & (capacity - 1);
+        while (table[slot] != 0xFFFFFFFFu && memcmp(vertices + (size_t)table[slot] * stride, v, bytes) != 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        if (table[slot] == 0xFFFFFFFFu) {
+            table[slot] = (unsigned int)i;
+            first[i] = (unsigned int)unique++;
+            out_remap[i] = first[i];
+        } else {
+            out_remap[i] = first[table[slot]];
+        }
+    }
+
+    free(table);
+    free(first);
+    return unique;
+}
+
+// Forsyth's vertex scoring: recently used vertices score high (except the last triangle's,
+// which the next one would mostly share anyway), and vertices with few remaining
+// triangles get a boost so they are finished off instead of lingering.
+#define FORSYTH_CACHE_SIZE 32
+#define FORSYTH_CACHE_DECAY_POWER 1.5f
+#define FORSYTH_LAST_TRI_SCORE 0.75f
+#define FORSYTH_VALENCE_BOOST_SCALE 2.0f
+#define FORSYTH_VALENCE_BOOST_POWER 0.5f
+
+static float forsyth_vertex_score(int cache_position, unsigned int live_triangles) {
+    if (live_triangles == 0) {
+        return -1.0f;
+    }
+    float score = 0.0f;
+    if (cache_position >= 0) {
+        if (cache_position < 3) {
+            score = FORSYTH_LAST_TRI_SCORE;
+        } else {
+            float scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score = powf(1.0f - (cache_position - 3) * scale, FORSYTH_CACHE_DECAY_POWER);
+        }
+    }
+    return score + FORSYTH_VALENCE_BOOST_SCALE * powf((float)live_triangles, -FORSYTH_VALENCE_BOOST_POWER);
+}
+
+int utils_mesh_optimize_vertex_cache(unsigned int* indices, size_t index_count, size_t vertex_count) {
+    size_t triangle_count = index_count / 3;
+    if (triangle_count == 0) {
+        return 1;
+    }
+
+    unsigned int* live = (unsigned int*)calloc(vertex_count, sizeof(unsigned int));
+    unsigned int* adjacency_offset = (unsigned int*)calloc(vertex_count + 1, sizeof(unsigned int));
+    unsigned int* adjacency = (unsigned int*)malloc(index_count * sizeof(unsigned int));
+    int* cache_position = (int*)malloc(vertex_count * sizeof(int));
+    float* vertex_score = (float*)malloc(vertex_count * sizeof(float));
+    float* triangle_score = (float*)malloc(triangle_count * sizeof(float));
+    unsigned char* emitted = (unsigned char*)calloc(triangle_count, 1);
+    unsigned int* output = (unsigned int*)malloc(index_count * sizeof(unsigned int));
+    int ok = live && adjacency_offset && adjacency && cache_position && vertex_score &&
+             triangle_score && emitted && output;
+
+    if (ok) {
+        // Triangles adjacent to each vertex; the first live[v] entries are still unemitted
+        for (size_t i = 0; i < triangle_count * 3; i++) {
+            live[indices[i]]++;
+        }
+        for (size_t v = 0; v < vertex_count; v++) {
+            adjacency_offset[v + 1] = adjacency_offset[v] + live[v];
+            cache_position[v] = -1;
+            vertex_score[v] = forsyth_vertex_score(-1, live[v]);
+        }
+        memset(live, 0, vertex_count * sizeof(unsigned int));
+        for (size_t t = 0; t < triangle_count; t++) {
+            for (int k = 0; k < 3; k++) {
+                unsigned int v = indices[t * 3 + k];
+                adjacency[adjacency_offset[v] + live[v]++] = (unsigned int)t;
+            }
+        }
+        for (size_t t = 0; t < triangle_count; t++) {
+            const unsigned int* tri = indices + t * 3;
+            triangle_score[t] = vertex_score[tri[0]] + vertex_score[tri[1]] + vertex_score[tri[2]];
+        }
+
+        unsigned int cache[FORSYTH_CACHE_SIZE + 3];
+        int cache_count = 0;
+        size_t cursor = 0;      // first triangle that may still be unemitted
+        long best = -1;
+
+        for (size_t emitted_count = 0; emitted_count < triangle_count; emitted_count++) {
+            if (best < 0) {
+                // Dead end: nothing in the cache has triangles left, restart at the next one in order
+                while (emitted[cursor]) cursor++;
+                best = (long)cursor;
+            }
+
+            const unsigned int* tri = indices + (size_t)best * 3;
+            memcpy(output + emitted_count * 3, tri, 3 * sizeof(unsigned int));
+            emitted[best] = 1;
+
+            // The triangle's vertices move to the front of the LRU cache
+            unsigned int next_cache[FORSYTH_CACHE_SIZE + 3];
+            int next_count = 0;
+            for (int k = 0; k < 3; k++) {
+                unsigned int v = tri[k];
+                next_cache[next_count++] = v;
+                // Drop the triangle from the vertex's live adjacency
+                unsigned int* list = adjacency + adjacency_offset[v];
+                for (unsigned int a = 0; a < live[v]; a++) {
+                    if (list[a] == (unsigned int)best) {
+                        list[a] = list[--live[v]];
+                        break;
+                    }
+                }
+            }
+            for (int c = 0; c < cache_count; c++) {
+                unsigned int v = cache[c];
+                if (v != tri[0] && v != tri[1] && v != tri[2]) {
+                    next_cache[next_count++] = v;
+                }
+            }
+
+            // Rescore everything that was or is in the cache, and pick the best triangle
+            // touching it for the next step
+            best = -1;
+            float best_score = -1.0f;
+            for (int c = 0; c < next_count; c++) {
+                unsigned int v = next_cache[c];
+                cache_position[v] = c < FORSYTH_CACHE_SIZE ? c : -1;
+                vertex_score[v] = forsyth_vertex_score(cache_position[v], live[v]);
+            }
+            for (int c = 0; c < next_count && c < FORSYTH_CACHE_SIZE; c++) {
+                unsigned int v = next_cache[c];
+                const unsigned int* list = adjacency + adjacency_offset[v];
+                for (unsigned int a = 0; a < live[v]; a++) {
+                    unsigned int t = list[a];
+                    const unsigned int* other = indices + (size_t)t * 3;
+                    triangle_score[t] = vertex_score[other[0]] + vertex_score[other[1]] + vertex_score[other[2]];
+                    if (triangle_score[t] > best_score) {
+                        best_score = triangle_score[t];
+                        best = (long)t;
+                    }
+                }
+            }
+
+            cache_count = next_count < FORSYTH_CACHE_SIZE ? next_count : FORSYTH_CACHE_SIZE;
+            memcpy(cache, next_cache, cache_count * sizeof(unsigned int));
+        }
+
+        memcpy(indices, output, triangle_count * 3 * sizeof(unsigned int));
+    }
+
+    free(live);
+    free(adjacency_offset);
+    free(adjacency);
+    free(cache_position);
+    free(vertex_score);
+    free(triangle_score);
+    free(emitted);
+    free(output);
+    return ok;
+}
+
+typedef struct {
+    size_t first;       // first triangle
+    size_t count;       // triangles
+    float sort_key;
+} MeshCluster;
+
+static int mesh_cluster_compare(const void* a, const void* b) {
+    float ka = ((const MeshCluster*)a)->sort_key;
+    float kb = ((const MeshCluster*)b)->sort_key;
+    return (ka < kb) - (ka > kb);   // descending
+}
+
+int utils_mesh_optimize_overdraw(unsigned int* indices, size_t index_count, const float* vertices,
+                                 size_t vertex_count, size_t stride, float threshold) {
+    size_t triangle_count = index_count / 3;
+    if (triangle_count < 2) {
+        return 0;
+    }
+
+    UtilsVertexCacheStats before;
+    utils_mesh_analyze_vertex_cache(indices, index_count, vertex_count, UTILS_VERTEX_CACHE_SIZE, &before);
+
+    MeshCluster* clusters = (MeshCluster*)malloc(triangle_count * sizeof(MeshCluster));
+    size_t* pushed_at = (size_t*)malloc(vertex_count * sizeof(size_t));
+    unsigned char* used = (unsigned char*)calloc(vertex_count, 1);
+    unsigned int* reordered = (unsigned int*)malloc(index_count * sizeof(unsigned int));
+    if (!clusters || !pushed_at || !used || !reordered) {
+        free(clusters);
+        free(pushed_at);
+        free(used);
+        free(reordered);
+        return 0;
+    }
+
+    // Hard boundaries: a triangle whose three vertices all miss the cache starts a new
+    // cluster, since moving it costs no reuse that was there to begin with
+    size_t cluster_count = 0;
+    size_t misses = 0;
+    for (size_t t = 0; t < triangle_count; t++) {
+        int triangle_misses = 0;
+        for (int k = 0; k < 3; k++) {
+            unsigned int v = indices[t * 3 + k];
+            if (used[v] && misses - pushed_at[v] < UTILS_VERTEX_CACHE_SIZE) continue;
+            used[v] = 1;
+            pushed_at[v] = misses++;
+            triangle_misses++;
+        }
+        if (t == 0 || triangle_misses == 3) {
+            clusters[cluster_count++] = (MeshCluster){ t, 0, 0.0f };
+        }
+        clusters[cluster_count - 1].count++;
+    }
+
+    // Area-weighted centroid and normal of each cluster, and of the whole mesh
+    float mesh_centroid[3] = {0.0f, 0.0f, 0.0f};
+    float mesh_area = 0.0f;
+    float* cluster_data = (float*)malloc(cluster_count * 6 * sizeof(float));
+    if (!cluster_data) {
+        free(clusters);
+        free(pushed_at);
+        free(used);
+        free(reordered);
+        return 0;
+    }
+    for (size_t c = 0; c < cluster_count; c++) {
+        float centroid[3] = {0.0f, 0.0f, 0.0f};
+        float normal[3] = {0.0f, 0.0f, 0.0f};
+        float area = 0.0f;
+        for (size_t t = clusters[c].first; t < clusters[c].first + clusters[c].count; t++) {
+            const float* p0 = vertices + (size_t)indices[t * 3] * stride;
+            const float* p1 = vertices + (size_t)indices[t * 3 + 1] * stride;
+            const float* p2 = vertices + (size_t)indices[t * 3 + 2] * stride;
+            float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+            float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+            float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+            float a = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int k = 0; k < 3; k++) {
+                centroid[k] += (p0[k] + p1[k] + p2[k]) * (a / 3.0f);
+                normal[k] += n[k];
+            }
+            area += a;
+        }
+        float inv_area = area > 0.0f ? 1.0f / area : 0.0f;
+        float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        float inv_length = length > 0.0f ? 1.0f / length : 0.0f;
+        for (int k = 0; k < 3; k++) {
+            mesh_centroid[k] += centroid[k];
+            cluster_data[c * 6 + k] = centroid[k] * inv_area;
+            cluster_data[c * 6 + 3 + k] = normal[k] * inv_length;
+        }
+        mesh_area += area;
+    }
+    for (int k = 0; k < 3; k++) {
+        mesh_centroid[k] = mesh_area > 0.0f ? mesh_centroid[k] / mesh_area : 0.0f;
+    }
+
+    // Clusters facing away from the center are likely in front of the others: draw them first
+    for (size_t c = 0; c < cluster_count; c++) {
+        const float* d = cluster_data + c * 6;
+        clusters[c].sort_key = (d[0] - mesh_centroid[0]) * d[3] + (d[1] - mesh_centroid[1]) * d[4] +
+                               (d[2] - mesh_centroid[2]) * d[5];
+    }
+    qsort(clusters, cluster_count, sizeof(MeshCluster), mesh_cluster_compare);
+
+    size_t written = 0;
+    for (size_t c = 0; c < cluster_count; c++) {
+        size_t count = clusters[c].count * 3;
+        memcpy(reordered + written, indices + clusters[c].first * 3, count * sizeof(unsigned int));
+        written += count;
+    }
+
+    UtilsVertexCacheStats after;
+    utils_mesh_analyze_vertex_cache(reordered, written, vertex_count, UTILS_VERTEX_CACHE_SIZE, &after);
+    int accepted = after.acmr <= before.acmr * threshold;
+    if (accepted) {
+        memcpy(indices, reordered, written * sizeof(unsigned int));
+    }
+
+    free(cluster_data);
+    free(clusters);
+    free(pushed_at);
+    free(used);
+    free(reordered);
+    return accepted;
+}
+
+size_t utils_mesh_optimize_vertex_fetch(float* vertices, size_t vertex_count, size_t stride,
+                                        unsigned int* indices, size_t index_count) {
+    unsigned int* remap = (unsigned int*)malloc(vertex_count * sizeof(unsigned int));
+    float* reordered = (float*)malloc(vertex_count * stride * sizeof(float));
+    if (!remap || !reordered) {
+        free(remap);
+        free(reordered);
+        return 0;
+    }
+    memset(remap, 0xFF, vertex_count * sizeof(unsigned int));
+
+    size_t next = 0;
+    for (size_t i = 0; i < index_count; i++) {
+        unsigned int v = indices[i];
+        if (remap[v] == 0xFFFFFFFFu) {
+            remap[v] = (unsigned int)next;
+            memcpy(reordered + next * stride, vertices + (size_t)v * stride, stride * sizeof(float));
+            next++;
+        }
+        indices[i] = remap[v];
+    }
+    // Unreferenced vertices keep their relative order behind the used ones
+    size_t used = next;
+    for (size_t v = 0; v < vertex_count; v++) {
+        if (remap[v] == 0xFFFFFFFFu) {
+            memcpy(reordered + next * stride, vertices + v * stride, stride * sizeof(float));
+            next++;
+        }
+    }
+
+    memcpy(vertices, reordered, vertex_count * stride * sizeof(float));
+    free(remap);
+    free(reordered);
+    return used;
+}
+
+int utils_mesh_optimize(const float* vertices, size_t vertex_count, size_t stride,
+                        const unsigned int* indices, size_t index_count, UtilsMesh* out_mesh) {
+    memset(out_mesh, 0, sizeof(*out_mesh));
+    if (!indices) {
+        index_count = vertex_count;
+    }
+    if (index_count < 3 || vertex_count == 0 || stride < 3) {
+        return 0;
+    }
+
+    unsigned int* remap = (unsigned int*)malloc(vertex_count * sizeof(unsigned int));
+    out_mesh->indices = (unsigned int*)malloc(index_count * sizeof(unsigned int));
+    if (!remap || !out_mesh->indices) {
+        free(remap);
+        utils_mesh_free(out_mesh);
+        return 0;
+    }
+
+    // Stats of the input as it would be drawn: unindexed input transforms every vertex
+    for (size_t i = 0; i < index_count; i++) {
+        out_mesh->indices[i] = indices ? indices[i] : (unsigned int)i;
+    }
+    utils_mesh_analyze_vertex_cache(out_mesh->indices, index_count, vertex_count, UTILS_VERTEX_CACHE_SIZE,
+                                    &out_mesh->before);
+
+    size_t unique = utils_mesh_weld(vertices, vertex_count, stride, remap);
+    out_mesh->vertices = (float*)malloc(unique * stride * sizeof(float));
+    if (unique == 0 || !out_mesh->vertices) {
+        free(remap);
+        utils_mesh_free(out_mesh);
+        return 0;
+    }
+    for (size_t v = 0; v < vertex_count; v++) {
+        memcpy(out_mesh->vertices + (size_t)remap[v] * stride, vertices + v * stride, stride * sizeof(float));
+    }
+    for (size_t i = 0; i < index_count; i++) {
+        out_mesh->indices[i] = remap[out_mesh->indices[i]];
+    }
+    free(remap);
+
+    out_mesh->vertex_count = unique;
+    out_mesh->stride = stride;
+    out_mesh->index_count = index_count - index_count % 3;
+
+    utils_mesh_optimize_vertex_cache(out_mesh->indices, out_mesh->index_count, unique);
+    utils_mesh_optimize_overdraw(out_mesh->indices, out_mesh->index_count, out_mesh->vertices, unique, stride, 1.05f);
+    size_t used = utils_mesh_optimize_vertex_fetch(out_mesh->vertices, unique, stride,
+                                                   out_mesh->indices, out_mesh->index_count);
+    if (used > 0) {
+        out_mesh->vertex_count = used;
+    }
+
+    utils_mesh_analyze_vertex_cache(out_mesh->indices, out_mesh->index_count, out_mesh->vertex_count,
+                                    UTILS_VERTEX_CACHE_SIZE, &out_mesh->after);
+    return 1;
+}
+
+void utils_mesh_free(UtilsMesh* mesh) {
+    free(mesh->vertices);
+    free(mesh->indices);
+    memset(mesh, 0, sizeof(*mesh));
+}
+
+#ifdef USE_OPENGL
+size_t utils_mesh_upload(const char* name, const float* vertices, size_t vertex_count, size_t stride,
+                         unsigned int vertex_buffer, unsigned int index_buffer) {
+    UtilsMesh mesh;
+    if (!utils_mesh_optimize(vertices, vertex_count, stride, NULL, 0, &mesh)) {
+        fprintf(stderr, "Failed to optimize %s mesh\n", name);
+        return 0;
+    }
+    printf("%s: %zu -> %zu vertices, ACMR %.2f -> %.2f, ATVR %.2f -> %.2f\n", name, vertex_count, mesh.vertex_count,
+           mesh.before.acmr, mesh.after.acmr, mesh.before.atvr, mesh.after.atvr);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+    glBufferData(GL_ARRAY_BUFFER, mesh.vertex_count * stride * sizeof(float), mesh.vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.index_count * sizeof(unsigned int), mesh.indices, GL_STATIC_DRAW);
+
+    size_t index_count = mesh.index_count;
+    utils_mesh_free(&mesh);
+    return index_count;
+}
+#endif
+
+// Mesh simplification and LOD
+// A quadric is the symmetric 4x4 matrix sum of plane outer products, stored as its upper
+// triangle: a2 ab ac ad b2 bc bd c2 cd d2, plus the summed area weight
+typedef struct {
+    double q[10];
+    double weight;
+} MeshQuadric;
+
+typedef struct {
+    float cost;
+    unsigned int from;  // position that moves
+    unsigned int to;    // position it moves onto
+} MeshCollapse;
+
+static int mesh_collapse_compare(const void* a, const void* b) {
+    float ca = ((const MeshCollapse*)a)->cost;
+    float cb = ((const MeshCollapse*)b)->cost;
+    return (ca > cb) - (ca < cb);
+}
+
+static void mesh_quadric_add_plane(MeshQuadric* quadric, const double* n, double d, double weight) {
+    double* q = quadric->q;
+    q[0] += weight * n[0] * n[0]; q[1] += weight * n[0] * n[1]; q[2] += weight * n[0] * n[2]; q[3] += weight * n[0] * d;
+    q[4] += weight * n[1] * n[1]; q[5] += weight * n[1] * n[2]; q[6] += weight * n[1] * d;
+    q[7] += weight * n[2] * n[2]; q[8] += weight * n[2] * d;
+    q[9] += weight * d * d;
+    quadric->weight += weight;
+}
+
+// Area-weighted mean squared distance from p to the planes of both quadrics
+static float mesh_quadric_error(const MeshQuadric* a, const MeshQuadric* b, const float* p) {
+    double q[10];
+    for (int i = 0; i < 10; i++) {
+        q[i] = a->q[i] + b->q[i];
+    }
+    double x = p[0], y = p[1], z = p[2];
+    double e = q[0] * x * x + 2.0 * q[1] * x * y + 2.0 * q[2] * x * z + 2.0 * q[3] * x +
+               q[4] * y * y + 2.0 * q[5] * y * z + 2.0 * q[6] * y +
+               q[7] * z * z + 2.0 * q[8] * z + q[9];
+    double weight = a->weight + b->weight;
+    return weight > 0.0 ? (float)(fabs(e) / weight) : 0.0f;
+}
+
+static void mesh_triangle_normal(const float* a, const float* b, const float* c, float* n) {
+    float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+// Rejects moving `from` onto `to` if a surviving triangle around it would turn by more than
+// ~75 degrees or collapse to nothing
+static int mesh_collapse_flips(const float* positions, const unsigned int* triangles,
+                               const unsigned int* adjacency_offsets, const unsigned int* adjacency,
+                               unsigned int from, unsigned int to) {
+    for (unsigned int k = adjacency_offsets[from]; k < adjacency_offsets[from + 1]; k++) {
+        const unsigned int* t = triangles + (size_t)adjacency[k] * 3;
+        if (t[0] == to || t[1] == to || t[2] == to) {
+            continue;   // becomes degenerate and is dropped
+        }
+        const float* p[3];
+        const float* moved[3];
+        for (int c = 0; c < 3; c++) {
+            p[c] = positions + (size_t)t[c] * 3;
+            moved[c] = t[c] == from ? positions + (size_t)to * 3 : p[c];
+        }
+        float before[3], after[3];
+        mesh_triangle_normal(p[0], p[1], p[2], before);
+        mesh_triangle_normal(moved[0], moved[1], moved[2], after);
+        float dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+        float lengths = sqrtf((before[0] * before[0] + before[1] * before[1] + before[2] * before[2]) *
+                              (after[0] * after[0] + after[1] * after[1] + after[2] * after[2]));
+        if (dot <= 0.25f * lengths) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Scratch state of one utils_mesh_simplify call. Topology works on unique positions, so
+// attribute seams do not look like holes; corners remember the original vertex they use.
+typedef struct {
+    size_t position_count;
+    float* positions;               // unique positions, scaled into the unit box
+    unsigned int* position_of;      // vertex -> position
+    unsigned int* vertex_at;        // position -> one of its vertices
+    unsigned char* seam;            // several vertices share the position
+    unsigned char* locked;          // seam or open boundary: never moves
+    unsigned char* touched;         // already involved in a collapse this pass
+    unsigned int* collapse_to;      // position -> position it moved onto this pass
+    MeshQuadric* quadrics;
+    unsigned int* adjacency_offsets;
+    unsigned int* adjacency;        // triangles around each position
+    size_t triangle_count;
+    unsigned int* triangles;        // positions, three per triangle
+    unsigned int* corners;          // original vertices, three per triangle
+    MeshCollapse* collapses;
+    size_t edge_capacity;
+    uint64_t* edges;                // open-addressed undirected edge keys
+    unsigned int* edge_uses;
+} MeshSimplifier;
+
+static void mesh_simplifier_free(MeshSimplifier* s) {
+    free(s->positions);
+    free(s->position_of);
+    free(s->vertex_at);
+    free(s->seam);
+    free(s->locked);
+    free(s->touched);
+    free(s->collapse_to);
+    free(s->quadrics);
+    free(s->adjacency_offsets);
+    free(s->adjacency);
+    free(s->triangles);
+    free(s->corners);
+    free(s->collapses);
+    free(s->edges);
+    free(s->edge_uses);
+}
+
+static int mesh_simplifier_init(MeshSimplifier* s, const float* vertices, size_t vertex_count, size_t stride,
+                                const unsigned int* indices, size_t index_count) {
+    memset(s, 0, sizeof(*s));
+    s->positions = (float*)malloc(vertex_count * 3 * sizeof(float));
+    s->position_of = (unsigned int*)malloc(vertex_count * sizeof(unsigned int));
+    if (!s->positions || !s->position_of) {
+        return 0;
+    }
+    for (size_t v = 0; v < vertex_count; v++) {
+        memcpy(s->positions + v * 3, vertices + v * stride, 3 * sizeof(float));
+    }
+    size_t position_count = utils_mesh_weld(s->positions, vertex_count, 3, s->position_of);
+    s->position_count = position_count;
+
+    s->edge_capacity = 16;
+    while (s->edge_capacity < index_count * 2) {
+        s->edge_capacity *= 2;
+    }
+    s->vertex_at = (unsigned int*)malloc(position_count * sizeof(unsigned int));
+    s->seam = (unsigned char*)calloc(position_count, 1);
+    s->locked = (unsigned char*)calloc(position_count, 1);
+    s->touched = (unsigned char*)malloc(position_count);
+    s->collapse_to = (unsigned int*)malloc(position_count * sizeof(unsigned int));
+    s->quadrics = (MeshQuadric*)calloc(position_count, sizeof(MeshQuadric));
+    s->adjacency_offsets = (unsigned int*)malloc((position_count + 1) * sizeof(unsigned int));
+    s->adjacency = (unsigned int*)malloc(index_count * sizeof(unsigned int));
+    s->triangles = (unsigned int*)malloc(index_count * sizeof(unsigned int));
+    s->corners = (unsigned int*)malloc(index_count * sizeof(unsigned int));
+    s->collapses = (MeshCollapse*)malloc(index_count * 2 * sizeof(MeshCollapse));
+    s->edges = (uint64_t*)malloc(s->edge_capacity * sizeof(uint64_t));
+    s->edge_uses = (unsigned int*)calloc(s->edge_capacity, sizeof(unsigned int));
+    if (position_count == 0 || !s->vertex_at || !s->seam || !s->locked || !s->touched || !s->collapse_to ||
+        !s->quadrics || !s->adjacency_offsets || !s->adjacency || !s->triangles || !s->corners ||
+        !s->collapses || !s->edges || !s->edge_uses) {
+        return 0;
+    }
+
+    // Work in the unit box so errors are relative to the mesh size
+    float min[3], max[3];
+    memcpy(min, vertices, sizeof(min));
+    memcpy(max, vertices, sizeof(max));
+    for (size_t v = 0; v < vertex_count; v++) {
+        for (int k = 0; k < 3; k++) {
+            float p = vertices[v * stride + k];
+            if (p < min[k]) min[k] = p;
+            if (p > max[k]) max[k] = p;
+        }
+    }
+    float extent = sqrtf((max[0] - min[0]) * (max[0] - min[0]) + (max[1] - min[1]) * (max[1] - min[1]) +
+                         (max[2] - min[2]) * (max[2] - min[2]));
+    float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+    memset(s->vertex_at, 0xFF, position_count * sizeof(unsigned int));
+    for (size_t v = 0; v < vertex_count; v++) {
+        unsigned int p = s->position_of[v];
+        if (s->vertex_at[p] == 0xFFFFFFFFu) {
+            s->vertex_at[p] = (unsigned int)v;
+        } else {
+            s->seam[p] = 1;
+        }
+        for (int k = 0; k < 3; k++) {
+            s->positions[(size_t)p * 3 + k] = (vertices[v * stride + k] - min[k]) * scale;
+        }
+    }
+
+    // Triangles already degenerate are dropped up front
+    for (size_t i = 0; i < index_count; i += 3) {
+        unsigned int* t = s->triangles + s->triangle_count * 3;
+        for (int c = 0; c < 3; c++) {
+            t[c] = s->position_of[indices[i + c]];
+            s->corners[s->triangle_count * 3 + c] = indices[i + c];
+        }
+        if (t[0] == t[1] || t[1] == t[2] || t[2] == t[0]) {
+            continue;
+        }
+        s->triangle_count++;
+
+        float n[3];
+        mesh_triangle_normal(s->positions + (size_t)t[0] * 3, s->positions + (size_t)t[1] * 3,
+                             s->positions + (size_t)t[2] * 3, n);
+        double length = sqrt((double)n[0] * n[0] + (double)n[1] * n[1] + (double)n[2] * n[2]);
+        if (length > 0.0) {
+            double plane[3] = { n[0] / length, n[1] / length, n[2] / length };
+            const float* p0 = s->positions + (size_t)t[0] * 3;
+            double d = -(plane[0] * p0[0] + plane[1] * p0[1] + plane[2] * p0[2]);
+            for (int c = 0; c < 3; c++) {
+                mesh_quadric_add_plane(&s->quadrics[t[c]], plane, d, length * 0.5);
+            }
+        }
+
+        // An edge used by a single triangle is an open boundary
+        for (int e = 0; e < 3; e++) {
+            unsigned int u = t[e], w = t[(e + 1) % 3];
+            uint64_t key = u < w ? ((uint64_t)u << 32 | w) : ((uint64_t)w << 32 | u);
+            size_t slot = (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & (s->edge_capacity - 1);
+            while (s->edge_uses[slot] && s->edges[slot] != key) {
+                slot = (slot + 1) & (s->edge_capacity - 1);
+            }
+            s->edges[slot] = key;
+            s->edge_uses[slot]++;
+        }
+    }
+    for (size_t slot = 0; slot < s->edge_capacity; slot++) {
+        if (s->edge_uses[slot] == 1) {
+            s->locked[s->edges[slot] >> 32] = 1;
+            s->locked[s->edges[slot] & 0xFFFFFFFFu] = 1;
+        }
+    }
+    for (size_t p = 0; p < position_count; p++) {
+        s->locked[p] |= s->seam[p];
+    }
+    return 1;
+}
+
+// One round of non-overlapping collapses, cheapest first; returns how many were made
+static size_t mesh_simplifier_pass(MeshSimplifier* s, size_t target_triangles, float error_limit, float* max_error) {
+    size_t corner_count = s->triangle_count * 3;
+    memset(s->adjacency_offsets, 0, (s->position_count + 1) * sizeof(unsigned int));
+    for (size_t i = 0; i < corner_count; i++) {
+        s->adjacency_offsets[s->triangles[i] + 1]++;
+    }
+    for (size_t p = 0; p < s->position_count; p++) {
+        s->adjacency_offsets[p + 1] += s->adjacency_offsets[p];
+    }
+    for (size_t i = 0; i < corner_count; i++) {
+        s->adjacency[s->adjacency_offsets[s->triangles[i]]++] = (unsigned int)(i / 3);
+    }
+    for (size_t p = s->position_count; p > 0; p--) {
+        s->adjacency_offsets[p] = s->adjacency_offsets[p - 1];
+    }
+    s->adjacency_offsets[0] = 0;
+
+    // Both directions of every edge; interior edges show up twice, which is harmless
+    size_t candidate_count = 0;
+    for (size_t i = 0; i < corner_count; i++) {
+        unsigned int u = s->triangles[i];
+        unsigned int w = s->triangles[i - i % 3 + (i + 1) % 3];
+        if (!s->locked[u] && !s->seam[w]) {
+            float cost = mesh_quadric_error(&s->quadrics[u], &s->quadrics[w], s->positions + (size_t)w * 3);
+            s->collapses[candidate_count++] = (MeshCollapse){ cost, u, w };
+        }
+        if (!s->locked[w] && !s->seam[u]) {
+            float cost = mesh_quadric_error(&s->quadrics[w], &s->quadrics[u], s->positions + (size_t)u * 3);
+            s->collapses[candidate_count++] = (MeshCollapse){ cost, w, u };
+        }
+    }
+    qsort(s->collapses, candidate_count, sizeof(MeshCollapse), mesh_collapse_compare);
+
+    // Each collapse removes about two triangles; keep a pass from overshooting the target
+    size_t collapse_limit = (s->triangle_count - target_triangles + 1) / 2;
+    size_t collapsed = 0;
+    memset(s->touched, 0, s->position_count);
+    for (size_t p = 0; p < s->position_count; p++) {
+        s->collapse_to[p] = (unsigned int)p;
+    }
+    for (size_t c = 0; c < candidate_count && collapsed < collapse_limit; c++) {
+        const MeshCollapse* collapse = &s->collapses[c];
+        if (collapse->cost > error_limit) {
+            break;
+        }
+        if (s->touched[collapse->from] || s->touched[collapse->to] ||
+            mesh_collapse_flips(s->positions, s->triangles, s->adjacency_offsets, s->adjacency,
+                                collapse->from, collapse->to)) {
+            continue;
+        }
+        // Everything around the moved position changes; leave it for the next pass
+        for (unsigned int k = s->adjacency_offsets[collapse->from]; k < s->adjacency_offsets[collapse->from + 1]; k++) {
+            const unsigned int* t = s->triangles + (size_t)s->adjacency[k] * 3;
+            s->touched[t[0]] = s->touched[t[1]] = s->touched[t[2]] = 1;
+        }
+        s->collapse_to[collapse->from] = collapse->to;
+        MeshQuadric* target = &s->quadrics[collapse->to];
+        for (int i = 0; i < 10; i++) {
+            target->q[i] += s->quadrics[collapse->from].q[i];
+        }
+        target->weight += s->quadrics[collapse->from].weight;
+        if (collapse->cost > *max_error) {
+            *max_error = collapse->cost;
+        }
+        collapsed++;
+    }
+
+    // Moved-onto positions are never seams, so their single vertex replaces the old corner
+    size_t kept = 0;
+    for (size_t t = 0; t < s->triangle_count; t++) {
+        unsigned int p[3], v[3];
+        for (int c = 0; c < 3; c++) {
+            unsigned int old = s->triangles[t * 3 + c];
+            p[c] = s->collapse_to[old];
+            v[c] = p[c] == old ? s->corners[t * 3 + c] : s->vertex_at[p[c]];
+        }
+        if (p[0] == p[1] || p[1] == p[2] || p[2] == p[0]) {
+            continue;
+        }
+        memcpy(s->triangles + kept * 3, p, sizeof(p));
+        memcpy(s->corners + kept * 3, v, sizeof(v));
+        kept++;
+    }
+    s->triangle_count = kept;
+    return collapsed;
+}
+
+size_t utils_mesh_simplify(const float* vertices, size_t vertex_count, size_t stride,
+                           const unsigned int* indices, size_t index_count,
+                           size_t target_index_count, float target_error,
+                           unsigned int* out_indices, float* out_error) {
+    if (out_error) {
+        *out_error = 0.0f;
+    }
+    index_count -= index_count % 3;
+    if (vertex_count == 0 || index_count == 0 || stride < 3) {
+        return 0;
+    }
+
+    MeshSimplifier s;
+    if (!mesh_simplifier_init(&s, vertices, vertex_count, stride, indices, index_count)) {
+        mesh_simplifier_free(&s);
+        return 0;
+    }
+
+    // Quadric errors are squared distances
+    float error_limit = target_error * target_error;
+    float max_error = 0.0f;
+    size_t target_triangles = target_index_count / 3;
+    while (s.triangle_count > target_triangles &&
+           mesh_simplifier_pass(&s, target_triangles, error_limit, &max_error) > 0) {
+    }
+
+    size_t written = s.triangle_count * 3;
+    memcpy(out_indices, s.corners, written * sizeof(unsigned int));
+    if (out_error) {
+        *out_error = sqrtf(max_error);
+    }
+    mesh_simplifier_free(&s);
+    return written;
+}
+
+int utils_mesh_build_lods(const float* vertices, size_t vertex_count, size_t stride,
+                          const unsigned int* indices, size_t index_count,
+                          size_t max_levels, float reduction, float max_error, UtilsMeshLods* out_lods) {
+    memset(out_lods, 0, sizeof(*out_lods));
+    index_count -= index_count % 3;
+    if (max_levels > UTILS_MESH_MAX_LODS) {
+        max_levels = UTILS_MESH_MAX_LODS;
+    }
+    if (index_count == 0 || max_levels == 0 || reduction <= 0.0f || reduction >= 1.0f) {
+        return 0;
+    }
+
+    // Every level is at most as large as level 0
+    out_lods->indices = (unsigned int*)malloc(index_count * max_levels * sizeof(unsigned int));
+    if (!out_lods->indices) {
+        return 0;
+    }
+    memcpy(out_lods->indices, indices, index_count * sizeof(unsigned int));
+    out_lods->levels[0] = (UtilsMeshLod){ 0, index_count, 0.0f };
+    out_lods->level_count = 1;
+    out_lods->index_count = index_count;
+
+    // Simplifier errors are relative to the bounding box diagonal
+    float min[3], max[3];
+    memcpy(min, vertices, sizeof(min));
+    memcpy(max, vertices, sizeof(max));
+    for (size_t v = 0; v < vertex_count; v++) {
+        for (int k = 0; k < 3; k++) {
+            float p = vertices[v * stride + k];
+            if (p < min[k]) min[k] = p;
+            if (p > max[k]) max[k] = p;
+        }
+    }
+    float extent = sqrtf((max[0] - min[0]) * (max[0] - min[0]) + (max[1] - min[1]) * (max[1] - min[1]) +
+                         (max[2] - min[2]) * (max[2] - min[2]));
+
+    float relative_error = 0.0f;
+    while (out_lods->level_count < max_levels) {
+        const UtilsMeshLod* previous = &out_lods->levels[out_lods->level_count - 1];
+        const unsigned int* source = out_lods->indices + previous->first_index;
+        unsigned int* destination = out_lods->indices + out_lods->index_count;
+        size_t target = (size_t)(previous->index_count * reduction) / 3 * 3;
+
+        // Errors of successive levels add up at worst
+        float level_error = 0.0f;
+        size_t count = utils_mesh_simplify(vertices, vertex_count, stride, source, previous->index_count,
+                                           target, max_error - relative_error, destination, &level_error);
+        if (count == 0 || count > previous->index_count - previous->index_count / 20) {
+            break;  // less than 5% smaller: the error limit or the locked vertices stop it
+        }
+        utils_mesh_optimize_vertex_cache(destination, count, vertex_count);
+
+        relative_error += level_error;
+        out_lods->levels[out_lods->level_count++] = (UtilsMeshLod){
+            out_lods->index_count, count, relative_error * extent
+        };
+        out_lods->index_count += count;
+    }
+    return 1;
+}
+
+void utils_mesh_lods_free(UtilsMeshLods* lods) {
+    free(lods->indices);
+    memset(lods, 0, sizeof(*lods));
+}
+
+float utils_lod_projection_scale(float fovy, float viewport_height) {
+    return viewport_height / (2.0f * tanf(fovy * 0.5f));
+}
+
+size_t utils_mesh_select_lod(const UtilsMeshLods* lods, float distance, float projection_scale,
+                             float max_pixel_error) {
+    size_t level = 0;
+    if (distance <= 0.0f) {
+        return 0;
+    }
+    // Errors only grow along the chain, so the last level that fits is the coarsest
+    for (size_t i = 1; i < lods->level_count; i++) {
+        if (lods->levels[i].error * projection_scale / distance > max_pixel_error) {
+            break;
+        }
+        level = i;
+    }
+    return level;
+}
+
+// Vertex quantization
+uint16_t utils_float_to_half(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    uint32_t magnitude = bits & 0x7FFFFFFFu;
+
+    if (magnitude >= 0x7F800000u) {
+        // Infinity stays infinity, NaN stays a (quiet) NaN
+        return (uint16_t)(sign | 0x7C00u | (magnitude > 0x7F800000u ? 0x200u : 0u));
+    }
+    if (magnitude >= 0x477FF000u) {
+        return (uint16_t)(sign | 0x7C00u);  // rounds past 65504
+    }
+    if (magnitude < 0x38800000u) {
+        // Subnormal half: shift the full mantissa into place with round to nearest even
+        if (magnitude < 0x33000000u) {
+            return (uint16_t)sign;
+        }
+        uint32_t exponent = magnitude >> 23;
+        uint32_t mantissa = (magnitude & 0x7FFFFFu) | 0x800000u;
+        uint32_t shift = 126 - exponent;   // half subnormals count in units of 2^-24
+        uint32_t half = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1u))) {
+            half++;
+        }
+        return (uint16_t)(sign | half);
+    }
+
+    // Normal: rebias the exponent, round the 13 dropped mantissa bits to nearest even
+    uint32_t half = (magnitude - 0x38000000u) >> 13;
+    uint32_t remainder = magnitude & 0x1FFFu;
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u))) {
+        half++;
+    }
+    return (uint16_t)(sign | half);
+}
+
+float utils_half_to_float(uint16_t value) {
+    uint32_t sign = (uint32_t)(value & 0x8000u) << 16;
+    uint32_t exponent = (value >> 10) & 0x1Fu;
+    uint32_t mantissa = value & 0x3FFu;
+    uint32_t bits;
+
+    if (exponent == 0x1Fu) {
+        bits = sign | 0x7F800000u | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+        bits = sign;
+    } else {
+        // Subnormal half: normalize into a float exponent
+        exponent = 113;
+        while (!(mantissa & 0x400u)) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FFu) << 13);
+    }
+
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+static int8_t snorm8(float value) {
+    value = utils_clamp(value, -1.0f, 1.0f) * 127.0f;
+    return (int8_t)(value >= 0.0f ? value + 0.5f : value - 0.5f);
+}
+
+void utils_octahedral_encode(const float* normal, int8_t* out) {
+    float l1 = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+    float u = l1 > 0.0f ? normal[0] / l1 : 0.0f;
+    float v = l1 > 0.0f ? normal[1] / l1 : 0.0f;
+    if (normal[2] < 0.0f) {
+        // Fold the lower hemisphere over the diagonals of the square
+        float fu = (1.0f - fabsf(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+        float fv = (1.0f - fabsf(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+        u = fu;
+        v = fv;
+    }
+    out[0] = snorm8(u);
+    out[1] = snorm8(v);
+}
+
+void utils_octahedral_decode(const int8_t* in, float* normal) {
+    // snorm8 to float as GL does it: -128 and -127 both map to -1
+    float x = in[0] < -127 ? -1.0f : in[0] / 127.0f;
+    float y = in[1] < -127 ? -1.0f : in[1] / 127.0f;
+    float z = 1.0f - fabsf(x) - fabsf(y);
+    float t = z < 0.0f ? -z : 0.0f;
+    x += x >= 0.0f ? -t : t;
+    y += y >= 0.0f ? -t : t;
+    float length = sqrtf(x * x + y * y + z * z);
+    float inv = length > 0.0f ? 1.0f / length : 0.0f;
+    normal[0] = x * inv;
+    normal[1] = y * inv;
+    normal[2] = z * inv;
+}
+
+unsigned char* utils_mesh_quantize(const float* vertices, size_t vertex_count, size_t stride,
+                                   int texcoord_offset, int normal_offset, UtilsQuantizedLayout* out_layout) {
+    memset(out_layout, 0, sizeof(*out_layout));
+    if (vertex_count == 0 || stride < 3) {
+        return NULL;
+    }
+
+    out_layout->stride = 4 * sizeof(uint16_t);
+    if (texcoord_offset >= 0) {
+        out_layout->texcoord_offset = out_layout->stride;
+        out_layout->stride += 2 * sizeof(uint16_t);
+    }
+    if (normal_offset >= 0) {
+        out_layout->normal_offset = out_layout->stride;
+        out_layout->stride += 4;
+    }
+
+    unsigned char* packed = (unsigned char*)calloc(vertex_count, out_layout->stride);
+    if (!packed) {
+        return NULL;
+    }
+
+    float min[3], max[3];
+    for (int k = 0; k < 3; k++) {
+        min[k] = max[k] = vertices[k];
+    }
+    for (size_t i = 1; i < vertex_count; i++) {
+        for (int k = 0; k < 3; k++) {
+            float p = vertices[i * stride + k];
+            if (p < min[k]) min[k] = p;
+            if (p > max[k]) max[k] = p;
+        }
+    }
+
+    // The dequantize matrix is scale by the extent, then translate by the minimum
+    float extent[3], inv_extent[3];
+    for (int k = 0; k < 3; k++) {
+        extent[k] = max[k] - min[k];
+        inv_extent[k] = extent[k] > 0.0f ? 1.0f / extent[k] : 0.0f;
+    }
+    utils_matrix_identity(out_layout->dequantize);
+    out_layout->dequantize[0] = extent[0];
+    out_layout->dequantize[5] = extent[1];
+    out_layout->dequantize[10] = extent[2];
+    out_layout->dequantize[12] = min[0];
+    out_layout->dequantize[13] = min[1];
+    out_layout->dequantize[14] = min[2];
+
+    for (size_t i = 0; i < vertex_count; i++) {
+        const float* v = vertices + i * stride;
+        unsigned char* out = packed + i * out_layout->stride;
+
+        uint16_t position[4] = {0, 0, 0, 0};
+        for (int k = 0; k < 3; k++) {
+            float t = (v[k] - min[k]) * inv_extent[k];
+            position[k] = (uint16_t)(utils_clamp(t, 0.0f, 1.0f) * 65535.0f + 0.5f);
+        }
+        memcpy(out, position, sizeof(position));
+
+        if (texcoord_offset >= 0) {
+            uint16_t texcoord[2] = {
+                utils_float_to_half(v[texcoord_offset]),
+                utils_float_to_half(v[texcoord_offset + 1])
+            };
+            memcpy(out + out_layout->texcoord_offset, texcoord, sizeof(texcoord));
+        }
+        if (normal_offset >= 0) {
+            utils_octahedral_encode(v + normal_offset, (int8_t*)(out + out_layout->normal_offset));
+        }
+    }
+    return packed;
+}
+
+// Additional utility functions
+
 float utils_lerp(float a, float b, float t) {
     return a + t * (b - a);
 }
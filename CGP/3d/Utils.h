@@ -2,6 +2,8 @@
 #define UTILS_H
 
 #include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
 
 // Conditional inclusions based on the graphics and math libraries being used
 #ifdef USE_OPENGL
@@ -21,6 +23,29 @@
 #include <raymath.h>
 #endif
 
+// Batch operations split large batches across pthreads when built with
+// -DUTILS_BATCH_THREADS -pthread on POSIX targets; emscripten needs -pthread as well
+#if defined(UTILS_BATCH_THREADS) && \
+    (!(defined(__unix__) || defined(__APPLE__)) || (defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)))
+#undef UTILS_BATCH_THREADS
+#endif
+
+/** Batches with at least this many matrices are split across worker threads */
+#ifndef UTILS_BATCH_THREAD_THRESHOLD
+#define UTILS_BATCH_THREAD_THRESHOLD 16384
+#endif
+
+// Storage class for per-thread state (the default random generator)
+#if !defined(UTILS_THREAD_LOCAL)
+#if defined(_MSC_VER)
+#define UTILS_THREAD_LOCAL __declspec(thread)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_THREADS__)
+#define UTILS_THREAD_LOCAL _Thread_local
+#else
+#define UTILS_THREAD_LOCAL __thread
+#endif
+#endif
+
 /**
  * @brief Structure representing material properties for lighting calculations
  */
@@ -41,6 +66,105 @@ typedef struct {
  */
 char* read_file(const char* file_path);
 
+/**
+ * @brief Read-only view of a whole file, memory-mapped where the platform allows it
+ *
+ * On POSIX the view maps the file directly (no copy, no size limit); on Windows and
+ * emscripten it falls back to a single buffered read. The data is not guaranteed to be
+ * NUL-terminated, so always pass length along (e.g. to glShaderSource).
+ */
+typedef struct {
+    const char* data;   /**< File contents */
+    size_t length;      /**< Size in bytes */
+    int mapped;         /**< 1 if data is a mapping, 0 if it is a heap copy */
+} UtilsFileView;
+
+/**
+ * @brief Opens a view of a file
+ * @param file_path Path to the file
+ * @param view Receives the view; release it with utils_file_view_close
+ * @return 1 on success, 0 if the file could not be opened or read
+ */
+int utils_file_view_open(const char* file_path, UtilsFileView* view);
+
+/**
+ * @brief Releases a file view
+ * @param view The view to release; safe to call on a zeroed or already closed view
+ */
+void utils_file_view_close(UtilsFileView* view);
+
+// std140 uniform blocks
+// A block is declared once as an X-macro list of X(glsl_type, name) fields:
+//
+//   #define BLOB_FIELDS(X) X(vec4, InnerColor) X(vec4, OuterColor) X(float, RadiusInner)
+//   UTILS_STD140_BLOCK(BlobSettings, BlobSettings, blob_settings, BLOB_FIELDS)
+//
+// which defines the C type BlobSettings with std140 member alignment (each member takes
+// its std140 alignment and size from the tables below, so the whole struct can be uploaded
+// as-is), blob_settings_glsl() returning the matching GLSL declaration of block
+// "BlobSettings", and blob_settings_fields() describing each member for
+// utils_std140_validate, which checks the layout against the driver's. Supported types:
+// float, int, uint, vec2, vec3, vec4, ivec4, mat3, mat4. Arrays are not supported (std140
+// pads every element to 16 bytes).
+
+/**
+ * @brief Layout of one member of a std140 block, as laid out in C
+ */
+typedef struct {
+    const char* name;   /**< Member name, shared by C and GLSL */
+    size_t offset;      /**< Byte offset in the C struct */
+    size_t size;        /**< Byte size in the C struct */
+} UtilsStd140Field;
+
+// Alignment and C storage of each supported type. vec3 takes 12 bytes, so a following
+// scalar packs into its last word exactly like std140; mat3 columns are padded to vec4.
+#define UTILS_STD140_ALIGN_float 4
+#define UTILS_STD140_ALIGN_int 4
+#define UTILS_STD140_ALIGN_uint 4
+#define UTILS_STD140_ALIGN_vec2 8
+#define UTILS_STD140_ALIGN_vec3 16
+#define UTILS_STD140_ALIGN_vec4 16
+#define UTILS_STD140_ALIGN_ivec4 16
+#define UTILS_STD140_ALIGN_mat3 16
+#define UTILS_STD140_ALIGN_mat4 16
+
+#define UTILS_STD140_CTYPE_float(name) float name
+#define UTILS_STD140_CTYPE_int(name) int32_t name
+#define UTILS_STD140_CTYPE_uint(name) uint32_t name
+#define UTILS_STD140_CTYPE_vec2(name) float name[2]
+#define UTILS_STD140_CTYPE_vec3(name) float name[3]
+#define UTILS_STD140_CTYPE_vec4(name) float name[4]
+#define UTILS_STD140_CTYPE_ivec4(name) int32_t name[4]
+#define UTILS_STD140_CTYPE_mat3(name) float name[12]
+#define UTILS_STD140_CTYPE_mat4(name) float name[16]
+
+#define UTILS_STD140_MEMBER(type, name) _Alignas(UTILS_STD140_ALIGN_##type) UTILS_STD140_CTYPE_##type(name);
+#define UTILS_STD140_FIELD(type, name) { #name, offsetof(Std140Block, name), sizeof(((Std140Block*)0)->name) },
+#define UTILS_STD140_GLSL_MEMBER(type, name) "    " #type " " #name ";\n"
+#define UTILS_STD140_COUNT(type, name) + 1
+
+/**
+ * @brief Defines a std140 block: the C struct, its GLSL declaration and its field table
+ *
+ * The members sit in an anonymous struct inside a 16-byte aligned union, so sizeof(CType)
+ * rounds up to a whole vec4 the way drivers size the block, even for blocks of scalars.
+ * @param CType Name of the C type
+ * @param Block Name of the uniform block in GLSL
+ * @param prefix Prefix of the generated prefix_glsl() and prefix_fields() functions
+ * @param FIELDS X-macro list of X(glsl_type, name) members
+ */
+#define UTILS_STD140_BLOCK(CType, Block, prefix, FIELDS) \
+    typedef union { struct { FIELDS(UTILS_STD140_MEMBER) }; _Alignas(16) unsigned char std140_align_; } CType; \
+    static inline const char* prefix##_glsl(void) { \
+        return "layout (std140) uniform " #Block " {\n" FIELDS(UTILS_STD140_GLSL_MEMBER) "};\n"; \
+    } \
+    static inline int prefix##_fields(const UtilsStd140Field** out_fields) { \
+        typedef CType Std140Block; \
+        static const UtilsStd140Field fields[] = { FIELDS(UTILS_STD140_FIELD) }; \
+        *out_fields = fields; \
+        return 0 FIELDS(UTILS_STD140_COUNT); \
+    }
+
 // OpenGL-specific functions
 #ifdef USE_OPENGL
 
@@ -50,6 +174,13 @@ char* read_file(const char* file_path);
  */
 int check_opengl_error(void);
 
+/**
+ * @brief Reports GL errors and warnings through a KHR_debug callback instead of glGetError polling
+ * @return 1 if the callback was installed (GL 4.3 or GL_KHR_debug), 0 otherwise
+ * @note Most drivers only report through it in a debug context (GLFW_OPENGL_DEBUG_CONTEXT)
+ */
+int utils_enable_debug_output(void);
+
 /**
  * @brief Prints the info log for a shader
  * @param shader The shader object to query
@@ -78,7 +209,7 @@ unsigned int prepare_shader(int shader_type, const char* shader_path);
 int finalize_shader_program(unsigned int program);
 
 /**
- * @brief Creates a shader program from vertex and fragment shaders
+ * @brief Creates a shader program from vertex and fragment shaders, using the program binary cache
  * @param vp Path to the vertex shader source file
  * @param fp Path to the fragment shader source file
  * @return The created shader program
@@ -86,7 +217,7 @@ int finalize_shader_program(unsigned int program);
 unsigned int create_shader_program(const char* vp, const char* fp);
 
 /**
- * @brief Creates a shader program from vertex, geometry, and fragment shaders
+ * @brief Creates a shader program from vertex, geometry, and fragment shaders, using the program binary cache
  * @param vp Path to the vertex shader source file
  * @param gp Path to the geometry shader source file
  * @param fp Path to the fragment shader source file
@@ -94,15 +225,385 @@ unsigned int create_shader_program(const char* vp, const char* fp);
  */
 unsigned int create_shader_program_with_geometry(const char* vp, const char* gp, const char* fp);
 
+// Program binary cache
+// Linked programs are saved with glGetProgramBinary and reloaded with glProgramBinary on
+// later runs. Entries are keyed by a hash of the shader sources and the GL vendor, renderer
+// and version strings, so a driver update or an edited shader simply misses the cache.
+// Any mismatch or corruption falls back to a normal compile and the entry is rewritten.
+
+/** Default directory for cached program binaries, relative to the working directory */
+#define UTILS_PROGRAM_CACHE_DEFAULT_DIR "shader_cache"
+
+/**
+ * @brief Sets the directory used by the program binary cache
+ * @param dir Directory path (created on first store), or NULL to disable the cache
+ */
+void utils_program_cache_set_dir(const char* dir);
+
+/**
+ * @brief Computes the cache key for a set of shader sources on the current context
+ * @param sources Source text of each stage, in attach order
+ * @param lengths Length in bytes of each source
+ * @param count Number of stages
+ * @return 64-bit FNV-1a hash of the sources and the driver strings
+ * @note Requires a current OpenGL context
+ */
+uint64_t utils_program_cache_key(const char* const* sources, const size_t* lengths, int count);
+
+/**
+ * @brief Loads a cached program binary
+ * @param key Key from utils_program_cache_key
+ * @return A linked program, or 0 on a miss, a driver mismatch or a corrupt entry
+ */
+unsigned int utils_program_cache_load(uint64_t key);
+
+/**
+ * @brief Saves a linked program to the cache
+ * @param program A program linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+ * @param key Key from utils_program_cache_key
+ * @return 1 if the binary was written, 0 otherwise
+ */
+int utils_program_cache_store(unsigned int program, uint64_t key);
+
+// Batch shader compilation
+// Submitting compiles and links every stage without querying any status, so the driver
+// can overlap the work (on its own threads when GL_KHR_parallel_shader_compile is
+// available). Polling finalizes programs as they complete, letting the render loop keep
+// running; without the extension each poll finalizes at most one program.
+
+/** Maximum number of programs in one UtilsShaderBatch */
+#define UTILS_SHADER_BATCH_MAX 32
+/** Maximum number of stages in one program */
+#define UTILS_PROGRAM_MAX_STAGES 3
+
+/**
+ * @brief State of a program in a UtilsShaderBatch
+ */
+typedef enum {
+    UTILS_PROGRAM_PENDING,  /**< Submitted, the driver may still be compiling or linking */
+    UTILS_PROGRAM_READY,    /**< Linked (or loaded from the binary cache) and usable */
+    UTILS_PROGRAM_FAILED    /**< A source file was missing or compile/link failed; logs were printed */
+} UtilsProgramStatus;
+
+/**
+ * @brief One program in a batch
+ */
+typedef struct {
+    unsigned int program;                               /**< Program object */
+    unsigned int shaders[UTILS_PROGRAM_MAX_STAGES];     /**< Stage objects, released once finalized */
+    int shader_count;                                   /**< Number of live stage objects */
+    uint64_t cache_key;                                 /**< Binary cache key of the sources */
+    UtilsProgramStatus status;                          /**< Current state */
+} UtilsBatchProgram;
+
+/**
+ * @brief A set of programs compiled together
+ */
+typedef struct {
+    UtilsBatchProgram programs[UTILS_SHADER_BATCH_MAX]; /**< Programs, indexed by handle */
+    int count;                                          /**< Number of submitted programs */
+    int pending;                                        /**< Programs not finalized yet */
+    int parallel;                                       /**< 1 if completion can be polled without blocking */
+} UtilsShaderBatch;
+
+/**
+ * @brief Initializes a batch and enables driver compile threads when supported
+ * @param batch The batch to initialize
+ * @note Requires a current OpenGL context
+ */
+void utils_shader_batch_init(UtilsShaderBatch* batch);
+
+/**
+ * @brief Submits a vertex + fragment program without waiting for it
+ * @param batch The batch
+ * @param vp Path to the vertex shader source file
+ * @param fp Path to the fragment shader source file
+ * @return Handle for the program, or -1 if the batch is full
+ */
+int utils_shader_batch_add(UtilsShaderBatch* batch, const char* vp, const char* fp);
+
+/**
+ * @brief Submits a vertex + geometry + fragment program without waiting for it
+ * @param batch The batch
+ * @param vp Path to the vertex shader source file
+ * @param gp Path to the geometry shader source file
+ * @param fp Path to the fragment shader source file
+ * @return Handle for the program, or -1 if the batch is full
+ */
+int utils_shader_batch_add_with_geometry(UtilsShaderBatch* batch, const char* vp, const char* gp, const char* fp);
+
+/**
+ * @brief Finalizes programs whose compilation has completed, without blocking when parallel compile is available
+ * @param batch The batch
+ * @return Number of programs still pending
+ */
+int utils_shader_batch_poll(UtilsShaderBatch* batch);
+
+/**
+ * @brief Blocks until every program in the batch is finalized
+ * @param batch The batch
+ */
+void utils_shader_batch_wait(UtilsShaderBatch* batch);
+
+/**
+ * @brief Returns the state of a submitted program
+ * @param batch The batch
+ * @param handle Handle returned when the program was added
+ * @return The program's status (UTILS_PROGRAM_FAILED for an invalid handle)
+ */
+UtilsProgramStatus utils_shader_batch_status(const UtilsShaderBatch* batch, int handle);
+
+/**
+ * @brief Returns a program once it is ready
+ * @param batch The batch
+ * @param handle Handle returned when the program was added
+ * @return The program object, or 0 while pending or after a failure
+ */
+unsigned int utils_shader_batch_program(const UtilsShaderBatch* batch, int handle);
+
+// Uniform reflection
+// After linking, a program's active uniforms and uniform blocks are enumerated once into a
+// table. Locations are resolved from it at init time and the setters below take those
+// locations directly, so per-frame code never looks uniforms up by name. Array uniforms are
+// stored without their "[0]" suffix; members of uniform blocks have location -1.
+
+/**
+ * @brief One active uniform of a program
+ */
+typedef struct {
+    const char* name;       /**< Uniform name, points into the table's name storage */
+    int location;           /**< Location for glUniform*, -1 for uniform block members */
+    unsigned int type;      /**< GL type, e.g. GL_FLOAT_MAT4 */
+    int size;               /**< Array length, 1 for non-arrays */
+    int block_index;        /**< Index of the containing uniform block, -1 for the default block */
+} UtilsUniformInfo;
+
+/**
+ * @brief One active uniform block of a program
+ */
+typedef struct {
+    const char* name;       /**< Block name */
+    unsigned int index;     /**< Block index for glUniformBlockBinding */
+    int binding;            /**< Binding point currently assigned */
+    int data_size;          /**< Minimum buffer size in bytes */
+} UtilsUniformBlockInfo;
+
+/**
+ * @brief Reflection table of a linked program, sorted by name
+ */
+typedef struct {
+    unsigned int program;           /**< Program the table describes */
+    UtilsUniformInfo* uniforms;     /**< Active uniforms */
+    int uniform_count;              /**< Number of active uniforms */
+    UtilsUniformBlockInfo* blocks;  /**< Active uniform blocks */
+    int block_count;                /**< Number of active uniform blocks */
+    char* names;                    /**< Storage for all names */
+} UtilsUniformTable;
+
+/**
+ * @brief Enumerates the active uniforms and uniform blocks of a linked program
+ * @param table The table to fill
+ * @param program A successfully linked program
+ * @return 1 on success, 0 on failure (the table is left empty)
+ */
+int utils_uniform_table_init(UtilsUniformTable* table, unsigned int program);
+
+/**
+ * @brief Releases the memory held by a table
+ * @param table The table to free
+ */
+void utils_uniform_table_free(UtilsUniformTable* table);
+
+/**
+ * @brief Looks up an active uniform
+ * @param table The table
+ * @param name Uniform name; for arrays either "name" or "name[0]"
+ * @return The uniform's entry, or NULL if it is not active
+ */
+const UtilsUniformInfo* utils_uniform_table_find(const UtilsUniformTable* table, const char* name);
+
+/**
+ * @brief Resolves a uniform location once, for use with the setters below
+ * @param table The table
+ * @param name Uniform name
+ * @return The location, or -1 if the uniform is not active (setters ignore -1, like GL)
+ */
+int utils_uniform_location(const UtilsUniformTable* table, const char* name);
+
+/**
+ * @brief Looks up an active uniform block
+ * @param table The table
+ * @param name Block name
+ * @return The block's entry, or NULL if it is not active
+ */
+const UtilsUniformBlockInfo* utils_uniform_table_find_block(const UtilsUniformTable* table, const char* name);
+
+/**
+ * @brief Sets an int, bool or sampler uniform of the current program
+ * @param location Location from utils_uniform_location
+ * @param value The value
+ */
+void utils_uniform_set_int(int location, int value);
+
+/**
+ * @brief Sets a float uniform of the current program
+ * @param location Location from utils_uniform_location
+ * @param value The value
+ */
+void utils_uniform_set_float(int location, float value);
+
+/**
+ * @brief Sets a vec3 uniform of the current program
+ * @param location Location from utils_uniform_location
+ * @param value 3 floats
+ */
+void utils_uniform_set_vec3(int location, const float* value);
+
+/**
+ * @brief Sets a vec4 uniform of the current program
+ * @param location Location from utils_uniform_location
+ * @param value 4 floats
+ */
+void utils_uniform_set_vec4(int location, const float* value);
+
+/**
+ * @brief Sets a mat3 uniform of the current program
+ * @param location Location from utils_uniform_location
+ * @param value 9 floats, column-major
+ */
+void utils_uniform_set_mat3(int location, const float* value);
+
+/**
+ * @brief Sets a mat4 uniform of the current program
+ * @param location Location from utils_uniform_location
+ * @param value 16 floats, column-major
+ */
+void utils_uniform_set_mat4(int location, const float* value);
+
+// Per-frame data
+// Camera and time values shared by every program through one std140 uniform block at a
+// fixed binding point. The buffer is written once per frame; programs only need their
+// block bound once after linking. Shaders declare the block as utils_frame_data_glsl()
+// returns it:
+//
+//   layout (std140) uniform FrameData {
+//       mat4 view;
+//       mat4 projection;
+//       mat4 view_projection;
+//       vec4 camera_pos;    // xyz, w unused
+//       float time;
+//   };
+
+/** Uniform buffer binding point of the FrameData block */
+#define UTILS_FRAME_DATA_BINDING 0
+/** Name of the block in GLSL */
+#define UTILS_FRAME_DATA_BLOCK "FrameData"
+
+/**
+ * @brief Members of the FrameData block: view and projection (column-major), projection * view,
+ * camera position in world space (w unused) and seconds since start
+ */
+#define UTILS_FRAME_DATA_FIELDS(X) \
+    X(mat4, view) \
+    X(mat4, projection) \
+    X(mat4, view_projection) \
+    X(vec4, camera_pos) \
+    X(float, time)
+
+/** CPU copy of the FrameData block, plus utils_frame_data_glsl() and utils_frame_data_fields() */
+UTILS_STD140_BLOCK(UtilsFrameData, FrameData, utils_frame_data, UTILS_FRAME_DATA_FIELDS)
+
+/**
+ * @brief Creates the FrameData uniform buffer and binds it to UTILS_FRAME_DATA_BINDING
+ * @return The buffer object, or 0 on failure
+ */
+unsigned int utils_frame_data_create(void);
+
+/**
+ * @brief Points a program's FrameData block at UTILS_FRAME_DATA_BINDING
+ * @param program A linked program
+ * @return 1 if the program uses the block, 0 otherwise
+ */
+int utils_frame_data_bind_program(unsigned int program);
+
+/**
+ * @brief Fills a FrameData from the camera state and derives view_projection
+ * @param data The block to fill
+ * @param view View matrix (16 floats)
+ * @param projection Projection matrix (16 floats)
+ * @param camera_pos Camera position (3 floats)
+ * @param time Seconds since start
+ */
+void utils_frame_data_set(UtilsFrameData* data, const float* view, const float* projection,
+                          const float* camera_pos, float time);
+
+/**
+ * @brief Uploads the block with a single buffer write
+ * @param buffer Buffer from utils_frame_data_create
+ * @param data The block contents
+ */
+void utils_frame_data_update(unsigned int buffer, const UtilsFrameData* data);
+
+/**
+ * @brief Checks a linked program's block layout against a UTILS_STD140_BLOCK struct
+ * @param program A linked program
+ * @param block_name Name of the uniform block in GLSL
+ * @param fields Field table from the generated prefix_fields()
+ * @param field_count Number of fields
+ * @param size sizeof the C struct
+ * @return 1 if every member's offset matches (mismatches are printed), 0 otherwise
+ * @note Meant for debug builds; it issues the reflection queries the struct exists to avoid
+ */
+int utils_std140_validate(unsigned int program, const char* block_name,
+                          const UtilsStd140Field* fields, int field_count, size_t size);
+
 #endif // USE_OPENGL
 
+// Trigonometry
+// Fused sine/cosine sharing one range reduction. Angles are in radians.
+
+/**
+ * @brief Accuracy levels for utils_sincos_batch
+ */
+typedef enum {
+    UTILS_SINCOS_PRECISE,   /**< Within 2 ulp of libm for |x| <= 8192, falls back to libm beyond */
+    UTILS_SINCOS_FAST       /**< Absolute error below 5e-5, enough for vertex positions and camera angles */
+} UtilsSincosAccuracy;
+
+/**
+ * @brief Computes sin and cos of the same angle at full float precision
+ * @param x The angle in radians
+ * @param s Receives sin(x)
+ * @param c Receives cos(x)
+ */
+void utils_sincosf(float x, float* s, float* c);
+
+/**
+ * @brief Computes sin and cos with shorter polynomials (see UTILS_SINCOS_FAST)
+ * @param x The angle in radians
+ * @param s Receives sin(x)
+ * @param c Receives cos(x)
+ */
+void utils_sincosf_fast(float x, float* s, float* c);
+
+/**
+ * @brief Computes sin and cos for an array of angles, four at a time with SSE2
+ * @param x Input angles in radians
+ * @param s Receives the sines (count floats)
+ * @param c Receives the cosines (count floats)
+ * @param count Number of angles
+ * @param accuracy UTILS_SINCOS_PRECISE or UTILS_SINCOS_FAST
+ */
+void utils_sincos_batch(const float* x, float* s, float* c, size_t count, UtilsSincosAccuracy accuracy);
+
 // Matrix operations (wrappers that work with different math libraries)
+// Matrices are 16 floats in column-major order, as expected by glUniformMatrix4fv.
 
 /**
- * @brief Multiplies two 4x4 matrices
+ * @brief Multiplies two 4x4 matrices (result = m1 * m2)
  * @param m1 The first matrix
  * @param m2 The second matrix
- * @param result The resulting matrix
+ * @param result The resulting matrix, may alias m1 or m2
  */
 void utils_matrix_multiply(float* m1, float* m2, float* result);
 
@@ -150,6 +651,188 @@ void utils_matrix_perspective(float* m, float fovy, float aspect, float near, fl
  */
 void utils_matrix_identity(float* m);
 
+// Batched matrix operations
+// These always use the native SIMD kernels, whichever math library backs the wrappers above.
+// Arrays are contiguous column-major matrices; allocate them with utils_aligned_alloc(32, ...)
+// for best throughput. Inputs and outputs must not overlap.
+
+/**
+ * @brief Structure-of-arrays storage for a batch of 4x4 matrices
+ */
+typedef struct {
+    float* m[16];   /**< m[e][i] is element e (column-major) of matrix i */
+    size_t count;   /**< Number of matrices in each array */
+} UtilsMat4SoA;
+
+/**
+ * @brief Allocates memory with the given alignment
+ * @param alignment Alignment in bytes (power of two, at least sizeof(void*))
+ * @param size Size in bytes
+ * @return The allocated block, or NULL on failure; release with utils_aligned_free
+ */
+void* utils_aligned_alloc(size_t alignment, size_t size);
+
+/**
+ * @brief Releases memory obtained from utils_aligned_alloc
+ * @param ptr The block to release
+ */
+void utils_aligned_free(void* ptr);
+
+/**
+ * @brief Sets how many threads large batches are split across
+ * @param count Number of threads, 1 to stay single-threaded, 0 for one per CPU (default).
+ *              Has no effect unless Utils.c is built with UTILS_BATCH_THREADS
+ */
+void utils_set_batch_threads(int count);
+
+/**
+ * @brief Multiplies matrices pairwise: result[i] = a[i] * b[i]
+ * @param a Array of count matrices
+ * @param b Array of count matrices
+ * @param result Array receiving count matrices
+ * @param count Number of matrices
+ */
+void utils_matrix_multiply_batch(const float* a, const float* b, float* result, size_t count);
+
+/**
+ * @brief Multiplies one matrix by many: result[i] = m * b[i] (e.g. view-projection * model)
+ * @param m The shared left-hand matrix
+ * @param b Array of count matrices
+ * @param result Array receiving count matrices
+ * @param count Number of matrices
+ */
+void utils_matrix_multiply_batch_left(const float* m, const float* b, float* result, size_t count);
+
+/**
+ * @brief Transforms homogeneous points: result[i] = m * points[i]
+ * @param m The transformation matrix
+ * @param points Array of count 4-component points
+ * @param result Array receiving count 4-component points
+ * @param count Number of points
+ */
+void utils_matrix_transform_points_batch(const float* m, const float* points, float* result, size_t count);
+
+/**
+ * @brief Inverts matrices: result[i] = inverse(m[i])
+ * @param m Array of count matrices
+ * @param result Array receiving count matrices (non-finite for singular inputs)
+ * @param count Number of matrices
+ */
+void utils_matrix_invert_batch(const float* m, float* result, size_t count);
+
+/**
+ * @brief Structure-of-arrays variant of utils_matrix_multiply_batch
+ * @param a First operand batch
+ * @param b Second operand batch
+ * @param result Batch receiving a * b; result->count matrices are processed
+ */
+void utils_matrix_multiply_batch_soa(const UtilsMat4SoA* a, const UtilsMat4SoA* b, UtilsMat4SoA* result);
+
+/**
+ * @brief Structure-of-arrays variant of utils_matrix_invert_batch
+ * @param m Batch to invert
+ * @param result Batch receiving the inverses; result->count matrices are processed
+ */
+void utils_matrix_invert_batch_soa(const UtilsMat4SoA* m, UtilsMat4SoA* result);
+
+// Affine transforms
+// Model and view matrices are always affine, so they can be stored as 3x4 and skip the
+// constant last row in every multiply and inverse.
+
+/**
+ * @brief Affine transform stored as a column-major 3x4 matrix
+ */
+typedef struct {
+    float m[12];    /**< Columns x, y, z and translation; the implicit last row is (0, 0, 0, 1) */
+} UtilsAffine;
+
+/**
+ * @brief Initializes an affine transform to identity
+ * @param a The transform to initialize
+ */
+void utils_affine_identity(UtilsAffine* a);
+
+/**
+ * @brief Extracts the affine part of a 4x4 matrix (the last row is discarded)
+ * @param m The 4x4 source matrix
+ * @param out The resulting affine transform
+ */
+void utils_affine_from_mat4(const float* m, UtilsAffine* out);
+
+/**
+ * @brief Expands an affine transform to a 4x4 matrix ready for glUniformMatrix4fv
+ * @param a The affine transform
+ * @param m Pointer to a 16-element float array to store the resulting matrix
+ */
+void utils_affine_to_mat4(const UtilsAffine* a, float* m);
+
+/**
+ * @brief Composes two affine transforms (out = a * b)
+ * @param a The first transform
+ * @param b The second transform
+ * @param out The resulting transform, may alias a or b
+ */
+void utils_affine_compose(const UtilsAffine* a, const UtilsAffine* b, UtilsAffine* out);
+
+/**
+ * @brief Multiplies a 4x4 matrix by an affine transform (result = m * a), e.g. projection * model-view
+ * @param m The 4x4 matrix
+ * @param a The affine transform
+ * @param result Pointer to a 16-element float array to store the resulting matrix
+ */
+void utils_affine_premultiply_mat4(const float* m, const UtilsAffine* a, float* result);
+
+/**
+ * @brief Applies a translation to an affine transform (a = a * T)
+ * @param a The transform to translate
+ * @param x Translation along the x-axis
+ * @param y Translation along the y-axis
+ * @param z Translation along the z-axis
+ */
+void utils_affine_translate(UtilsAffine* a, float x, float y, float z);
+
+/**
+ * @brief Applies a rotation to an affine transform (a = a * R)
+ * @param a The transform to rotate
+ * @param angle The rotation angle in radians
+ * @param x X component of the rotation axis
+ * @param y Y component of the rotation axis
+ * @param z Z component of the rotation axis
+ */
+void utils_affine_rotate(UtilsAffine* a, float angle, float x, float y, float z);
+
+/**
+ * @brief Applies a scale to an affine transform (a = a * S)
+ * @param a The transform to scale
+ * @param x Scale factor for the x-axis
+ * @param y Scale factor for the y-axis
+ * @param z Scale factor for the z-axis
+ */
+void utils_affine_scale(UtilsAffine* a, float x, float y, float z);
+
+/**
+ * @brief Inverts a general affine transform (3x3 inverse plus translation fix-up)
+ * @param a The transform to invert
+ * @param out The resulting inverse, may alias a
+ * @return 1 on success, 0 if the transform is singular (out is left unchanged)
+ */
+int utils_affine_inverse(const UtilsAffine* a, UtilsAffine* out);
+
+/**
+ * @brief Inverts a rigid transform (rotation and translation only) by transposition
+ * @param a The transform to invert; must not contain scale or shear
+ * @param out The resulting inverse, may alias a
+ */
+void utils_affine_inverse_rigid(const UtilsAffine* a, UtilsAffine* out);
+
+/**
+ * @brief Computes the normal matrix (inverse transpose of the upper 3x3)
+ * @param a The model or model-view transform
+ * @param out Pointer to a 9-element float array (column-major mat3) for glUniformMatrix3fv
+ * @return 1 on success, 0 if the transform is singular
+ */
+int utils_affine_normal_matrix(const UtilsAffine* a, float* out);
+
 // Material properties
 
 /**
@@ -170,10 +853,84 @@ Material silver_material(void);
  */
 Material bronze_material(void);
 
-// Additional utility functions
+// Random numbers
+
+/**
+ * @brief xoshiro128+ generator state, 16 bytes, not shared between threads
+ *
+ * Each thread gets its own default generator (see utils_random_rng), so the
+ * utils_random_* functions never contend on a lock the way rand() does.
+ */
+typedef struct {
+    uint32_t s[4];
+} UtilsRng;
+
+/**
+ * @brief Seeds a generator; the same seed always gives the same sequence
+ * @param rng The generator to seed
+ * @param seed Any 64-bit value, expanded with splitmix64
+ */
+void utils_rng_seed(UtilsRng* rng, uint64_t seed);
+
+/**
+ * @brief Returns the next 32 random bits
+ * @param rng The generator to advance
+ * @return A uniformly distributed 32-bit value
+ */
+uint32_t utils_rng_next(UtilsRng* rng);
 
 /**
- * @brief Generates a random float within a specified range
+ * @brief Generates a random float in [min, max)
+ * @param rng The generator to advance
+ * @param min The minimum value of the range
+ * @param max The maximum value of the range
+ * @return A random float between min and max
+ */
+float utils_rng_float(UtilsRng* rng, float min, float max);
+
+/**
+ * @brief Generates a random integer in [min, max] without modulo bias
+ * @param rng The generator to advance
+ * @param min The minimum value of the range
+ * @param max The maximum value of the range
+ * @return A random integer between min and max (inclusive)
+ */
+int utils_rng_int(UtilsRng* rng, int min, int max);
+
+/**
+ * @brief Fills a buffer with random floats in [min, max), four lanes at a time with SSE2
+ * @param rng The generator to draw from; the output does not match repeated utils_rng_float calls
+ * @param out Destination buffer
+ * @param count Number of floats to write
+ * @param min The minimum value of the range
+ * @param max The maximum value of the range
+ */
+void utils_rng_fill_floats(UtilsRng* rng, float* out, size_t count, float min, float max);
+
+/**
+ * @brief Fills a buffer with random integers in [min, max] without modulo bias
+ * @param rng The generator to draw from
+ * @param out Destination buffer
+ * @param count Number of integers to write
+ * @param min The minimum value of the range
+ * @param max The maximum value of the range
+ */
+void utils_rng_fill_ints(UtilsRng* rng, int* out, size_t count, int min, int max);
+
+/**
+ * @brief Returns the calling thread's default generator, seeding it on first use
+ * @return The thread-local generator used by utils_random_float/int
+ */
+UtilsRng* utils_random_rng(void);
+
+/**
+ * @brief Seeds the calling thread's default generator (replaces srand)
+ * @param seed Any 64-bit value
+ */
+void utils_random_seed(uint64_t seed);
+
+/**
+ * @brief Generates a random float within a specified range using the thread's default generator
  * @param min The minimum value of the range
  * @param max The maximum value of the range
  * @return A random float between min and max
@@ -181,13 +938,299 @@ Material bronze_material(void);
 float utils_random_float(float min, float max);
 
 /**
- * @brief Generates a random integer within a specified range
+ * @brief Generates a random integer within a specified range using the thread's default generator
  * @param min The minimum value of the range
  * @param max The maximum value of the range
  * @return A random integer between min and max (inclusive)
  */
 int utils_random_int(int min, int max);
 
+// Mesh optimization
+// Offline passes for static meshes, run once at load time before upload. Vertices are
+// arrays of floats with a fixed stride (in floats) whose first three floats are the
+// position; indices describe a triangle list. The usual order is weld, vertex cache,
+// overdraw, vertex fetch, which is what utils_mesh_optimize does.
+
+// FIFO size used for the analysis, and the cache the Forsyth-style optimizer models
+#define UTILS_VERTEX_CACHE_SIZE 16
+
+/**
+ * @brief Post-transform cache efficiency of an index buffer
+ */
+typedef struct {
+    float acmr;     /**< Vertices transformed per triangle: 3.0 is no reuse, 0.5 is ideal */
+    float atvr;     /**< Vertices transformed per vertex referenced: 1.0 is ideal */
+} UtilsVertexCacheStats;
+
+/**
+ * @brief Simulates a FIFO post-transform cache over an index buffer
+ * @param indices Triangle list
+ * @param index_count Number of indices
+ * @param vertex_count Number of vertices the indices refer to
+ * @param cache_size FIFO entries to simulate, e.g. UTILS_VERTEX_CACHE_SIZE
+ * @param out_stats Receives ACMR and ATVR
+ */
+void utils_mesh_analyze_vertex_cache(const unsigned int* indices, size_t index_count, size_t vertex_count,
+                                     int cache_size, UtilsVertexCacheStats* out_stats);
+
+/**
+ * @brief Finds bitwise-identical vertices
+ * @param vertices Vertex array
+ * @param vertex_count Number of vertices
+ * @param stride Floats per vertex
+ * @param out_remap Receives, for every input vertex, the index of its unique vertex;
+ * unique vertices are numbered in order of first appearance
+ * @return Number of unique vertices, 0 on allocation failure
+ */
+size_t utils_mesh_weld(const float* vertices, size_t vertex_count, size_t stride, unsigned int* out_remap);
+
+/**
+ * @brief Reorders triangles for the post-transform vertex cache (Forsyth's linear-speed algorithm)
+ * @param indices Triangle list, reordered in place
+ * @param index_count Number of indices
+ * @param vertex_count Number of vertices the indices refer to
+ * @return 1 on success, 0 on allocation failure (indices are left untouched)
+ */
+int utils_mesh_optimize_vertex_cache(unsigned int* indices, size_t index_count, size_t vertex_count);
+
+/**
+ * @brief Reorders clusters of cache-optimized triangles so outward-facing ones come first
+ * @param indices Triangle list from utils_mesh_optimize_vertex_cache, reordered in place
+ * @param index_count Number of indices
+ * @param vertices Vertex array, position in the first three floats
+ * @param vertex_count Number of vertices
+ * @param stride Floats per vertex
+ * @param threshold Largest ACMR growth accepted, e.g. 1.05; the order is kept if exceeded
+ * @return 1 if the new order was kept, 0 otherwise
+ * @note Only cache-hostile boundaries are moved, so the vertex cache result mostly survives
+ */
+int utils_mesh_optimize_overdraw(unsigned int* indices, size_t index_count, const float* vertices,
+                                 size_t vertex_count, size_t stride, float threshold);
+
+/**
+ * @brief Reorders vertices in order of first use and rewrites the indices to match
+ * @param vertices Vertex array, reordered in place
+ * @param vertex_count Number of vertices
+ * @param stride Floats per vertex
+ * @param indices Triangle list, rewritten in place
+ * @param index_count Number of indices
+ * @return Number of vertices in use (unreferenced ones end up past it), 0 on allocation failure
+ */
+size_t utils_mesh_optimize_vertex_fetch(float* vertices, size_t vertex_count, size_t stride,
+                                        unsigned int* indices, size_t index_count);
+
+/**
+ * @brief An indexed mesh produced by utils_mesh_optimize
+ */
+typedef struct {
+    float* vertices;                /**< vertex_count * stride floats */
+    size_t vertex_count;
+    size_t stride;                  /**< Floats per vertex */
+    unsigned int* indices;          /**< Triangle list */
+    size_t index_count;
+    UtilsVertexCacheStats before;   /**< Cache stats of the input */
+    UtilsVertexCacheStats after;    /**< Cache stats of the result */
+} UtilsMesh;
+
+/**
+ * @brief Runs all passes: weld, vertex cache, overdraw (threshold 1.05) and vertex fetch
+ * @param vertices Vertex array
+ * @param vertex_count Number of vertices
+ * @param stride Floats per vertex, position first
+ * @param indices Triangle list, or NULL if every three vertices form a triangle
+ * @param index_count Number of indices (ignored when indices is NULL)
+ * @param out_mesh Receives the optimized mesh; release it with utils_mesh_free
+ * @return 1 on success, 0 on failure
+ */
+int utils_mesh_optimize(const float* vertices, size_t vertex_count, size_t stride,
+                        const unsigned int* indices, size_t index_count, UtilsMesh* out_mesh);
+
+/**
+ * @brief Frees a mesh returned by utils_mesh_optimize
+ * @param mesh The mesh to free
+ */
+void utils_mesh_free(UtilsMesh* mesh);
+
+#ifdef USE_OPENGL
+/**
+ * @brief Optimizes a triangle soup with utils_mesh_optimize, prints the cache stats and uploads it
+ * @param name Mesh name for the stats line and errors
+ * @param vertices Vertex array, every three vertices form a triangle
+ * @param vertex_count Number of vertices
+ * @param stride Floats per vertex, position first
+ * @param vertex_buffer Buffer that receives the vertices (bound to GL_ARRAY_BUFFER)
+ * @param index_buffer Buffer that receives the indices (bound to GL_ELEMENT_ARRAY_BUFFER, so bind the VAO first)
+ * @return Number of indices to draw, or 0 on failure
+ */
+size_t utils_mesh_upload(const char* name, const float* vertices, size_t vertex_count, size_t stride,
+                         unsigned int vertex_buffer, unsigned int index_buffer);
+#endif
+
+// Mesh simplification and LOD
+// Edge collapses ordered by quadric error (Garland-Heckbert). Vertices only ever collapse
+// onto neighbouring vertices, so every level indexes the original vertex buffer and a LOD
+// chain needs nothing but extra indices. Vertices on open boundaries and on attribute seams
+// (several vertices at one position) never move, so silhouettes of open meshes and UV seams
+// stay intact; collapses that would flip a triangle are rejected.
+
+#define UTILS_MESH_MAX_LODS 8
+
+/**
+ * @brief Reduces the triangle count of an indexed mesh
+ * @param vertices Vertex array, position in the first three floats
+ * @param vertex_count Number of vertices
+ * @param stride Floats per vertex
+ * @param indices Triangle list
+ * @param index_count Number of indices
+ * @param target_index_count Stop once at most this many indices remain
+ * @param target_error Largest error accepted, relative to the mesh's bounding box diagonal
+ * (0.01 is 1%); stops early rather than exceed it
+ * @param out_indices Receives the simplified triangle list; room for index_count indices
+ * @param out_error Receives the relative error reached, may be NULL
+ * @return Number of indices written
+ */
+size_t utils_mesh_simplify(const float* vertices, size_t vertex_count, size_t stride,
+                           const unsigned int* indices, size_t index_count,
+                           size_t target_index_count, float target_error,
+                           unsigned int* out_indices, float* out_error);
+
+/**
+ * @brief One level of a LOD chain: a range of UtilsMeshLods.indices
+ */
+typedef struct {
+    size_t first_index;
+    size_t index_count;
+    float error;        /**< Object-space deviation from the full mesh, in position units */
+} UtilsMeshLod;
+
+/**
+ * @brief LOD chain over one vertex buffer, finest level first
+ */
+typedef struct {
+    unsigned int* indices;      /**< Every level back to back, for a single index buffer */
+    size_t index_count;
+    UtilsMeshLod levels[UTILS_MESH_MAX_LODS];
+    size_t level_count;
+} UtilsMeshLods;
+
+/**
+ * @brief Builds a LOD chain, each level simplified from the previous one and cache optimized
+ * @param vertices Vertex array, position in the first three floats
+ * @param vertex_count Number of vertices
+ * @param stride Floats per vertex
+ * @param indices Triangle list of level 0
+ * @param index_count Number of indices
+ * @param max_levels Levels to build including level 0, at most UTILS_MESH_MAX_LODS
+ * @param reduction Triangle ratio between consecutive levels, e.g. 0.5
+ * @param max_error Relative error (see utils_mesh_simplify) no level may exceed
+ * @param out_lods Receives the chain; release it with utils_mesh_lods_free
+ * @return 1 on success, 0 on failure
+ * @note The chain ends early once a level cannot get meaningfully smaller
+ */
+int utils_mesh_build_lods(const float* vertices, size_t vertex_count, size_t stride,
+                          const unsigned int* indices, size_t index_count,
+                          size_t max_levels, float reduction, float max_error, UtilsMeshLods* out_lods);
+
+/**
+ * @brief Frees a chain built by utils_mesh_build_lods
+ * @param lods The chain to free
+ */
+void utils_mesh_lods_free(UtilsMeshLods* lods);
+
+/**
+ * @brief Pixels per unit of object-space error at distance 1
+ * @param fovy Vertical field of view in radians
+ * @param viewport_height Viewport height in pixels
+ * @return The scale to pass to utils_mesh_select_lod
+ */
+float utils_lod_projection_scale(float fovy, float viewport_height);
+
+/**
+ * @brief Picks the coarsest level whose error projects to at most max_pixel_error pixels
+ * @param lods The chain
+ * @param distance Distance from the camera to the object, in the same units as the error
+ * (scale the distance down by the object's scale factor for scaled instances)
+ * @param projection_scale From utils_lod_projection_scale
+ * @param max_pixel_error Screen-space error allowed, e.g. 1.0
+ * @return The level index
+ */
+size_t utils_mesh_select_lod(const UtilsMeshLods* lods, float distance, float projection_scale,
+                             float max_pixel_error);
+
+// Vertex quantization
+// Packs float vertices into compact attributes at load time:
+//   position  4 x unorm16 (w unused) relative to the mesh bounding box, 8 bytes
+//   texcoord  2 x half float, 4 bytes
+//   normal    2 x snorm8 octahedral encoding (+2 bytes padding), 4 bytes
+// Bind positions as GL_UNSIGNED_SHORT normalized and multiply the model matrix by the
+// layout's dequantize matrix; shaders need no change for positions or texcoords. Normals
+// are decoded with UTILS_GLSL_OCTAHEDRAL_DECODE; build the normal matrix from the original
+// model matrix, not the one with dequantize folded in.
+
+/**
+ * @brief GLSL source of vec3 utils_octahedral_decode(vec2 e), for snorm8x2 normals
+ */
+#define UTILS_GLSL_OCTAHEDRAL_DECODE \
+    "vec3 utils_octahedral_decode(vec2 e) {\n" \
+    "    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));\n" \
+    "    float t = max(-n.z, 0.0);\n" \
+    "    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);\n" \
+    "    return normalize(n);\n" \
+    "}\n"
+
+/**
+ * @brief Where utils_mesh_quantize put each attribute
+ */
+typedef struct {
+    size_t stride;              /**< Bytes per packed vertex */
+    size_t texcoord_offset;     /**< Byte offset of the half2 texcoord, 0 if there is none */
+    size_t normal_offset;       /**< Byte offset of the snorm8x2 normal, 0 if there is none */
+    float dequantize[16];       /**< Maps unorm16 positions back to object space (column-major) */
+} UtilsQuantizedLayout;
+
+/**
+ * @brief Converts a float to IEEE half precision, rounding to nearest even
+ * @param value The value to convert; out-of-range values become infinity
+ * @return The half float bits
+ */
+uint16_t utils_float_to_half(float value);
+
+/**
+ * @brief Converts IEEE half precision bits to a float
+ * @param value The half float bits
+ * @return The value as a float
+ */
+float utils_half_to_float(uint16_t value);
+
+/**
+ * @brief Encodes a unit normal into two snorm8 values (octahedral mapping)
+ * @param normal Pointer to 3 floats; need not be normalized
+ * @param out Pointer to 2 int8_t values
+ */
+void utils_octahedral_encode(const float* normal, int8_t* out);
+
+/**
+ * @brief Decodes two snorm8 values back into a unit normal, as the GLSL decode does
+ * @param in Pointer to 2 int8_t values
+ * @param normal Pointer to 3 floats
+ */
+void utils_octahedral_decode(const int8_t* in, float* normal);
+
+/**
+ * @brief Packs float vertices into the quantized layout described above
+ * @param vertices Vertex array, position in the first three floats
+ * @param vertex_count Number of vertices
+ * @param stride Floats per vertex
+ * @param texcoord_offset Float offset of a 2-float texcoord, or -1
+ * @param normal_offset Float offset of a 3-float normal, or -1
+ * @param out_layout Receives the packed stride, attribute offsets and dequantize matrix
+ * @return vertex_count * out_layout->stride bytes to free() after upload, or NULL on failure
+ */
+unsigned char* utils_mesh_quantize(const float* vertices, size_t vertex_count, size_t stride,
+                                   int texcoord_offset, int normal_offset, UtilsQuantizedLayout* out_layout);
+
+// Additional utility functions
+
 /**
  * @brief Performs linear interpolation between two values
  * @param a The start value
@@ -1,12 +1,13 @@
 #include <cglm/cglm.h>
 #include "Utils.h"
 #include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
 #define numVAOs 1
-#define numVBOs 2
+#define numVBOs 4   // cube and pyramid vertices, then their indices
 
 float cameraX, cameraY, cameraZ;
 float cubeLocX, cubeLocY, cubeLocZ;
@@ -14,13 +15,16 @@ float pyrLocX, pyrLocY, pyrLocZ;
 GLuint renderingProgram;
 GLuint vao[numVAOs];
 GLuint vbo[numVBOs];
+GLsizei cubeIndexCount, pyramidIndexCount;
 
 // Allocate variables used in display() function
 int width, height;
 float aspect;
 float timeFactor;
-GLuint mvLoc, projLoc, tfLoc;
-mat4 pMat, vMat, mMat, mvMat;
+GLint mvLoc, projLoc, tfLoc;
+UtilsUniformTable uniforms;
+mat4 pMat, mvMat;
+UtilsAffine vMat, mMat, mvAff;  // view and model are affine, only the projection needs 4x4
 
 void setupVertices(void) {
     float vertexPositions[108] = {
@@ -50,16 +54,22 @@ void setupVertices(void) {
     glGenVertexArrays(numVAOs, vao);
     glBindVertexArray(vao[0]);
     glGenBuffers(numVBOs, vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertexPositions), vertexPositions, GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ARRAY_BUFFER, vbo[1]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(pyramidPositions), pyramidPositions, GL_STATIC_DRAW);
-
+    cubeIndexCount = (GLsizei)utils_mesh_upload("cube", vertexPositions, 36, 3, vbo[0], vbo[2]);
+    pyramidIndexCount = (GLsizei)utils_mesh_upload("pyramid", pyramidPositions, 18, 3, vbo[1], vbo[3]);
+    if (cubeIndexCount == 0 || pyramidIndexCount == 0) {
+        exit(EXIT_FAILURE);
+    }
 }
 
 void init(GLFWwindow* window) {
     renderingProgram = create_shader_program("shaders/vertShader.glsl", "shaders/fragShader.glsl");
+
+    // Resolve uniform locations once instead of every frame
+    utils_uniform_table_init(&uniforms, renderingProgram);
+    mvLoc = utils_uniform_location(&uniforms, "v_matrix");
+    projLoc = utils_uniform_location(&uniforms, "proj_matrix");
+    tfLoc = utils_uniform_location(&uniforms, "tf");
+
     cameraX = 0.0f; cameraY = 0.0f; cameraZ = 20.0f;
 cubeLocX = -2.0f; cubeLocY = 0.0f; cubeLocZ = 0.0f;
     pyrLocX = 5.0f; pyrLocY = 5.0f; pyrLocZ = 0.0f;
@@ -71,10 +81,6 @@ void display(GLFWwindow* window, double currentTime) {
     glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
     glUseProgram(renderingProgram);
 
-    // Get uniform locations
-    mvLoc = glGetUniformLocation(renderingProgram, "v_matrix");
-    projLoc = glGetUniformLocation(renderingProgram, "proj_matrix");
-
     // Get framebuffer size and set viewport
     glfwGetFramebufferSize(window, &width, &height);
     glViewport(0, 0, width, height);  // Set the viewport to cover the entire window
@@ -85,56 +91,56 @@ void display(GLFWwindow* window, double currentTime) {
     glm_perspective(glm_rad(45.0f), aspect, 0.1f, 1000.0f, pMat);
 
     // Set up view matrix: translate the camera position
-    glm_mat4_identity(vMat);
-    glm_translate(vMat, (vec3){-cameraX, -cameraY, -cameraZ});
+    utils_affine_identity(&vMat);
+    utils_affine_translate(&vMat, -cameraX, -cameraY, -cameraZ);
 
     // draw the cube (buffer 0)
-    glm_mat4_identity(mMat);
-    glm_translate(mMat, (vec3){cubeLocX, cubeLocY, cubeLocZ});
-    glm_mat4_identity(mvMat);
-    glm_mat4_mul(vMat, mMat, mvMat);
-
+    utils_affine_identity(&mMat);
+    utils_affine_translate(&mMat, cubeLocX, cubeLocY, cubeLocZ);
+    utils_affine_compose(&vMat, &mMat, &mvAff);
+    utils_affine_to_mat4(&mvAff, (float*)mvMat);
 
     // Set uniforms
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, (float*)pMat);
-    glUniformMatrix4fv(mvLoc, 1, GL_FALSE, (float*)vMat);
+    utils_uniform_set_mat4(projLoc, (float*)pMat);
+    utils_uniform_set_mat4(mvLoc, (float*)mvMat);
 
     /*
     // Set time factor for animation
     timeFactor = (float)currentTime;
-    tfLoc = glGetUniformLocation(renderingProgram, "tf");
-    glUniform1f(tfLoc, timeFactor);
+    utils_uniform_set_float(tfLoc, timeFactor);
     */
 
     // Bind VBO and set up vertex attribute
     glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
     glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo[2]);
 
     // Enable depth testing and render the cubes
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LEQUAL);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
+    glDrawElements(GL_TRIANGLES, cubeIndexCount, GL_UNSIGNED_INT, 0);
 
     // draw the pyramid (buffer 1)
-    glm_mat4_identity(mMat);
-    glm_translate(mMat, (vec3){pyrLocX, pyrLocY, pyrLocZ});
-    glm_mat4_identity(mvMat);
-    glm_mat4_mul(vMat,mMat,mvMat);
+    utils_affine_identity(&mMat);
+    utils_affine_translate(&mMat, pyrLocX, pyrLocY, pyrLocZ);
+    utils_affine_compose(&vMat, &mMat, &mvAff);
+    utils_affine_to_mat4(&mvAff, (float*)mvMat);
 
     // Set uniforms
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, (float*)pMat);
-    glUniformMatrix4fv(mvLoc, 1, GL_FALSE, (float*)mvMat);
+    utils_uniform_set_mat4(projLoc, (float*)pMat);
+    utils_uniform_set_mat4(mvLoc, (float*)mvMat);
 
     // Bind VBO and set up vertex attribute
     glBindBuffer(GL_ARRAY_BUFFER, vbo[1]);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
     glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo[3]);
 
     // Enable depth testing and render the cubes
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LEQUAL);
-    glDrawArrays(GL_TRIANGLES, 0, 18);
+    glDrawElements(GL_TRIANGLES, pyramidIndexCount, GL_UNSIGNED_INT, 0);
 
 
 }
@@ -3,11 +3,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#define USE_OPENGL   // 3d/Utils.c must be built with -DUSE_OPENGL as well
+#include "3d/Utils.h"
 
 #define numVAOs 1
 
 GLuint renderingProgram;
 GLuint vao[numVAOs];
+UtilsUniformTable uniforms;
+GLint offsetLoc;
 
 // location of triangle on x axis
 float x = 0.0f;
@@ -51,48 +55,30 @@ int checkOpenGLError() {
     return foundError;
 }
 
-char* readShaderSource(const char *filePath) {
-    FILE* file = fopen(filePath, "r");
-    if (file == NULL) {
-        printf("Failed to open file: %s\n", filePath);
-        return NULL;
-    }
-
-    fseek(file, 0, SEEK_END);
-    long length = ftell(file);
-    fseek(file, 0, SEEK_SET);
-
-    char* content = (char*)malloc(length + 1);
-    if (content == NULL) {
-        printf("Failed to allocate memory for file content\n");
-        fclose(file);
-        return NULL;
-    }
-
-    fread(content, 1, length, file);
-    content[length] = '\0';
-
-    fclose(file);
-    return content;
-}
-
 GLuint createShaderProgram() {
     GLint vertCompiled;
     GLint fragCompiled;
     GLint linked;
     
-    char* vertShaderSrc = readShaderSource("vShader.glsl");
-    char* fragShaderSrc = readShaderSource("fShader.glsl");
-    
-    if (vertShaderSrc == NULL || fragShaderSrc == NULL) {
+    UtilsFileView vertShaderSrc;
+    UtilsFileView fragShaderSrc;
+    if (!utils_file_view_open("vShader.glsl", &vertShaderSrc)) {
+        return 0;
+    }
+    if (!utils_file_view_open("fShader.glsl", &fragShaderSrc)) {
+        utils_file_view_close(&vertShaderSrc);
         return 0;
     }
     
     GLuint vShader = glCreateShader(GL_VERTEX_SHADER);
     GLuint fShader = glCreateShader(GL_FRAGMENT_SHADER);
     
-    glShaderSource(vShader, 1, (const GLchar**)&vertShaderSrc, NULL);
-    glShaderSource(fShader, 1, (const GLchar**)&fragShaderSrc, NULL);
+    GLint vertLength = (GLint)vertShaderSrc.length;
+    GLint fragLength = (GLint)fragShaderSrc.length;
+    glShaderSource(vShader, 1, &vertShaderSrc.data, &vertLength);
+    glShaderSource(fShader, 1, &fragShaderSrc.data, &fragLength);
+    utils_file_view_close(&vertShaderSrc);
+    utils_file_view_close(&fragShaderSrc);
     
     glCompileShader(vShader);
     checkOpenGLError();
@@ -122,14 +108,14 @@ GLuint createShaderProgram() {
         printProgramLog(vfProgram);
     }
     
-    free(vertShaderSrc);
-    free(fragShaderSrc);
-    
     return vfProgram;
 }
 
 void init(GLFWwindow* window) {
     renderingProgram = createShaderProgram();
+    // resolve the uniform location once instead of every frame
+    utils_uniform_table_init(&uniforms, renderingProgram);
+    offsetLoc = utils_uniform_location(&uniforms, "offset");
     glGenVertexArrays(numVAOs, vao);
     glBindVertexArray(vao[0]);
 }
@@ -149,9 +135,6 @@ void display(GLFWwindow* window, double currentTime) {
     // switch to moving the triangle to the right
     if (x < -1.0f) inc = 0.01f;
     
-    // get ptr to "offset"
-    GLuint offsetLoc = glGetUniformLocation(renderingProgram, "offset");
-    
     glProgramUniform1f(renderingProgram, offsetLoc, x);
     
     glDrawArrays(GL_TRIANGLES, 0, 3);
@@ -4,6 +4,17 @@
 #include <stdlib.h>
 #include <string.h>
 #include <cglm/cglm.h>
+#define USE_OPENGL   // Utils.c must be built with -DUSE_OPENGL as well
+#include "../learnopengl/Utils.h"
+
+// Must match the BlobSettings block in shader/basic_uniformblock.frag (binding = 1)
+#define BLOB_SETTINGS_BINDING 1
+#define BLOB_SETTINGS_FIELDS(X) \
+    X(vec4, InnerColor) \
+    X(vec4, OuterColor) \
+    X(float, RadiusInner) \
+    X(float, RadiusOuter)
+UTILS_STD140_BLOCK(BlobSettings, BlobSettings, blob_settings, BLOB_SETTINGS_FIELDS)
 
 GLuint prog;  // Assuming this is a global program handle
 GLuint vaoHandle;
@@ -19,23 +30,15 @@ void resize(int w, int h);
 
 GLuint compileShader(const char* filepath, GLenum shaderType) {
     GLuint shader = glCreateShader(shaderType);
-    FILE *file = fopen(filepath, "r");
-    if (!file) {
+    UtilsFileView source;
+    if (!utils_file_view_open(filepath, &source)) {
         fprintf(stderr, "Error: Could not open shader file %s\n", filepath);
         exit(EXIT_FAILURE);
     }
 
-    fseek(file, 0, SEEK_END);
-    long fileSize = ftell(file);
-    rewind(file);
-
-    char *source = (char *)malloc(fileSize + 1);
-    fread(source, 1, fileSize, file);
-    source[fileSize] = '\0';
-    fclose(file);
-
-    glShaderSource(shader, 1, (const GLchar* const*)&source, NULL);
-    free(source);
+    GLint sourceLength = (GLint)source.length;
+    glShaderSource(shader, 1, &source.data, &sourceLength);
+    utils_file_view_close(&source);
 
     glCompileShader(shader);
     GLint compileStatus;
@@ -75,40 +78,26 @@ void compile() {
 }
 
 void initUniformBlockBuffer() {
-    GLuint programHandle = prog;
-    GLuint blockIndex = glGetUniformBlockIndex(programHandle, "BlobSettings");
-
-    GLint blockSize;
-    glGetActiveUniformBlockiv(programHandle, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
-    GLubyte *blockBuffer = (GLubyte *)malloc(blockSize);
-
-    const GLchar *names[] = {
-        "BlobSettings.InnerColor", "BlobSettings.OuterColor",
-        "BlobSettings.RadiusInner", "BlobSettings.RadiusOuter"
+    // The C struct already has the std140 layout, so it is uploaded as-is
+    BlobSettings settings = {
+        .InnerColor = {1.0f, 1.0f, 0.75f, 1.0f},
+        .OuterColor = {0.0f, 0.0f, 0.0f, 0.0f},
+        .RadiusInner = 0.25f,
+        .RadiusOuter = 0.45f,
     };
 
-    GLuint indices[4];
-    glGetUniformIndices(programHandle, 4, names, indices);
-
-    GLint offset[4];
-    glGetActiveUniformsiv(programHandle, 4, indices, GL_UNIFORM_OFFSET, offset);
-
-    vec4 outerColor = {0.0f, 0.0f, 0.0f, 0.0f};
-    vec4 innerColor = {1.0f, 1.0f, 0.75f, 1.0f};
-    GLfloat innerRadius = 0.25f, outerRadius = 0.45f;
-
-    memcpy(blockBuffer + offset[0], innerColor, 4 * sizeof(GLfloat));
-    memcpy(blockBuffer + offset[1], outerColor, 4 * sizeof(GLfloat));
-    memcpy(blockBuffer + offset[2], &innerRadius, sizeof(GLfloat));
-    memcpy(blockBuffer + offset[3], &outerRadius, sizeof(GLfloat));
+#ifndef NDEBUG
+    const UtilsStd140Field* fields;
+    int fieldCount = blob_settings_fields(&fields);
+    utils_std140_validate(prog, "BlobSettings", fields, fieldCount, sizeof(BlobSettings));
+#endif
 
     GLuint uboHandle;
     glGenBuffers(1, &uboHandle);
     glBindBuffer(GL_UNIFORM_BUFFER, uboHandle);
-    glBufferData(GL_UNIFORM_BUFFER, blockSize, blockBuffer, GL_DYNAMIC_DRAW);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(settings), &settings, GL_DYNAMIC_DRAW);
 
-    glBindBufferBase(GL_UNIFORM_BUFFER, 1, uboHandle);
-    free(blockBuffer);
+    glBindBufferBase(GL_UNIFORM_BUFFER, BLOB_SETTINGS_BINDING, uboHandle);
 }
 
 void initScene() {
@@ -0,0 +1,283 @@
+// Vertex throughput benchmark for the Utils.c LOD chain
+//
+// Draws a field of dense spheres receding to ~400 units, once with every instance at full
+// detail and once with a level picked per instance from its projected error. Instances are
+// bucketed by level and each bucket is one instanced draw, so both runs issue few calls and
+// the difference is the vertex work. Frame time is measured with GL_TIME_ELAPSED queries.
+//
+//   gcc -O2 -DUSE_OPENGL bench_lod.c Utils.c -o bench_lod -lglfw -lGLEW -lGL -lm
+//
+// Results are printed and written to bench_lod_output.txt.
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#ifndef USE_OPENGL
+#define USE_OPENGL   // Utils.c must be built with -DUSE_OPENGL as well
+#endif
+#include "Utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define BENCH_WIDTH 1280
+#define BENCH_HEIGHT 720
+#define BENCH_FOVY 0.785398f            // 45 degrees
+#define BENCH_SPHERE_SEGMENTS 128       // 128x128 quads, ~32k triangles per sphere
+#define BENCH_GRID 40                   // BENCH_GRID^2 instances
+#define BENCH_FAR 400.0f
+#define BENCH_LOD_LEVELS 8
+#define BENCH_PIXEL_ERROR 1.0f
+#define BENCH_FRAMES 60
+#define BENCH_OUTPUT "bench_lod_output.txt"
+#define PI 3.14159265358979323846f
+
+static const char* vertexShaderSource = "#version 330 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "layout (location = 1) in vec3 aNormal;\n"
+    "layout (location = 2) in vec3 aOffset;\n"
+    "uniform mat4 viewProjection;\n"
+    "out vec3 normal;\n"
+    "void main()\n"
+    "{\n"
+    "    normal = aNormal;\n"
+    "    gl_Position = viewProjection * vec4(aPos + aOffset, 1.0);\n"
+    "}\0";
+
+static const char* fragmentShaderSource = "#version 330 core\n"
+    "in vec3 normal;\n"
+    "out vec4 FragColor;\n"
+    "void main()\n"
+    "{\n"
+    "    float light = max(dot(normalize(normal), normalize(vec3(0.3, 1.0, 0.5))), 0.1);\n"
+    "    FragColor = vec4(vec3(light), 1.0);\n"
+    "}\0";
+
+// Unit sphere with position + normal; the seam and poles are welded by utils_mesh_optimize
+static void buildSphere(int segments, float** outVertices, size_t* outVertexCount,
+                        unsigned int** outIndices, size_t* outIndexCount) {
+    size_t vertexCount = (size_t)(segments + 1) * (segments + 1);
+    float* vertices = (float*)malloc(vertexCount * 6 * sizeof(float));
+    unsigned int* indices = (unsigned int*)malloc((size_t)segments * segments * 6 * sizeof(unsigned int));
+    for (int i = 0; i <= segments; i++) {
+        float theta = PI * i / segments;
+        for (int j = 0; j <= segments; j++) {
+            float phi = 2.0f * PI * (j % segments) / segments;
+            float* v = vertices + ((size_t)i * (segments + 1) + j) * 6;
+            float ring = (i == 0 || i == segments) ? 0.0f : sinf(theta);
+            v[0] = ring * cosf(phi);
+            v[1] = cosf(theta);
+            v[2] = ring * sinf(phi);
+            memcpy(v + 3, v, 3 * sizeof(float));
+        }
+    }
+    size_t k = 0;
+    for (int i = 0; i < segments; i++) {
+        for (int j = 0; j < segments; j++) {
+            unsigned int a = (unsigned int)(i * (segments + 1) + j);
+            unsigned int b = a + segments + 1;
+            indices[k++] = a; indices[k++] = b; indices[k++] = a + 1;
+            indices[k++] = a + 1; indices[k++] = b; indices[k++] = b + 1;
+        }
+    }
+    *outVertices = vertices;
+    *outVertexCount = vertexCount;
+    *outIndices = indices;
+    *outIndexCount = k;
+}
+
+int main(void) {
+    if (!glfwInit()) return 1;
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(BENCH_WIDTH, BENCH_HEIGHT, "bench_lod", NULL, NULL);
+    if (!window) {
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    glewExperimental = GL_TRUE;
+    if (glewInit() != GLEW_OK) return 1;
+    glfwSwapInterval(0);
+
+    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
+    glCompileShader(vertexShader);
+    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
+    glCompileShader(fragmentShader);
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    GLint linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        fprintf(stderr, "Failed to build the benchmark shader\n");
+        return 1;
+    }
+
+    // Mesh and LOD chain
+    float* rawVertices;
+    unsigned int* rawIndices;
+    size_t rawVertexCount, rawIndexCount;
+    buildSphere(BENCH_SPHERE_SEGMENTS, &rawVertices, &rawVertexCount, &rawIndices, &rawIndexCount);
+    UtilsMesh sphere;
+    if (!utils_mesh_optimize(rawVertices, rawVertexCount, 6, rawIndices, rawIndexCount, &sphere)) {
+        fprintf(stderr, "Failed to optimize the sphere\n");
+        return 1;
+    }
+    free(rawVertices);
+    free(rawIndices);
+
+    double buildStart = glfwGetTime();
+    UtilsMeshLods lods;
+    if (!utils_mesh_build_lods(sphere.vertices, sphere.vertex_count, 6, sphere.indices, sphere.index_count,
+                               BENCH_LOD_LEVELS, 0.5f, 0.1f, &lods)) {
+        fprintf(stderr, "Failed to build LODs\n");
+        return 1;
+    }
+    double buildTime = glfwGetTime() - buildStart;
+
+    // Instances on the ground plane, from just in front of the camera out to BENCH_FAR
+    size_t instanceCount = BENCH_GRID * BENCH_GRID;
+    float* offsets = (float*)malloc(instanceCount * 3 * sizeof(float));
+    float* sorted = (float*)malloc(instanceCount * 3 * sizeof(float));
+    size_t* levelOf = (size_t*)malloc(instanceCount * sizeof(size_t));
+    for (size_t i = 0; i < instanceCount; i++) {
+        float x = ((float)(i % BENCH_GRID) / (BENCH_GRID - 1) - 0.5f) * BENCH_FAR * 0.6f;
+        float z = -4.0f - (float)(i / BENCH_GRID) / (BENCH_GRID - 1) * BENCH_FAR;
+        offsets[i * 3] = x;
+        offsets[i * 3 + 1] = -1.5f;
+        offsets[i * 3 + 2] = z;
+    }
+
+    GLuint vao, vbo, ebo, instanceVbo;
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+    glGenBuffers(1, &instanceVbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sphere.vertex_count * 6 * sizeof(float), sphere.vertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    // Every level lives in one index buffer
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, lods.index_count * sizeof(unsigned int), lods.indices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+    glBufferData(GL_ARRAY_BUFFER, instanceCount * 3 * sizeof(float), NULL, GL_STREAM_DRAW);
+    glVertexAttribDivisor(2, 1);
+    glEnableVertexAttribArray(2);
+
+    float view[16], projection[16], viewProjection[16];
+    utils_matrix_identity(view);
+    utils_matrix_perspective(projection, BENCH_FOVY, (float)BENCH_WIDTH / BENCH_HEIGHT, 0.1f, 1000.0f);
+    utils_matrix_multiply(projection, view, viewProjection);
+    glUseProgram(program);
+    glUniformMatrix4fv(glGetUniformLocation(program, "viewProjection"), 1, GL_FALSE, viewProjection);
+    glViewport(0, 0, BENCH_WIDTH, BENCH_HEIGHT);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+
+    FILE* report = fopen(BENCH_OUTPUT, "w");
+    if (report == NULL) {
+        fprintf(stderr, "Failed to open %s for writing\n", BENCH_OUTPUT);
+        return 1;
+    }
+    char line[256];
+    snprintf(line, sizeof(line), "LOD benchmark: %zu spheres of %zu triangles, %d frames at %dx%d\n",
+             instanceCount, sphere.index_count / 3, BENCH_FRAMES, BENCH_WIDTH, BENCH_HEIGHT);
+    fputs(line, stdout);
+    fputs(line, report);
+    for (size_t l = 0; l < lods.level_count; l++) {
+        snprintf(line, sizeof(line), "  level %zu: %7zu triangles, error %.4f\n",
+                 l, lods.levels[l].index_count / 3, lods.levels[l].error);
+        fputs(line, stdout);
+        fputs(line, report);
+    }
+    snprintf(line, sizeof(line), "  built in %.1f ms\n", buildTime * 1e3);
+    fputs(line, stdout);
+    fputs(line, report);
+    snprintf(line, sizeof(line), "%-8s %12s %12s %14s\n", "mode", "GPU ms", "Mtris/frame", "Mtris/s");
+    fputs(line, stdout);
+    fputs(line, report);
+
+    float projectionScale = utils_lod_projection_scale(BENCH_FOVY, BENCH_HEIGHT);
+    GLuint query;
+    glGenQueries(1, &query);
+
+    for (int useLods = 0; useLods <= 1; useLods++) {
+        double gpuSeconds = 0.0;
+        size_t trianglesPerFrame = 0;
+        for (int frame = 0; frame < BENCH_FRAMES + 1; frame++) {
+            // Pick a level per instance (the camera sits at the origin) and bucket by level
+            size_t bucketStart[UTILS_MESH_MAX_LODS + 1] = {0};
+            for (size_t i = 0; i < instanceCount; i++) {
+                const float* o = offsets + i * 3;
+                float distance = sqrtf(o[0] * o[0] + o[1] * o[1] + o[2] * o[2]);
+                levelOf[i] = useLods ? utils_mesh_select_lod(&lods, distance, projectionScale, BENCH_PIXEL_ERROR) : 0;
+                bucketStart[levelOf[i] + 1]++;
+            }
+            for (size_t l = 0; l < lods.level_count; l++) {
+                bucketStart[l + 1] += bucketStart[l];
+            }
+            size_t fill[UTILS_MESH_MAX_LODS];
+            memcpy(fill, bucketStart, sizeof(fill));
+            for (size_t i = 0; i < instanceCount; i++) {
+                memcpy(sorted + fill[levelOf[i]]++ * 3, offsets + i * 3, 3 * sizeof(float));
+            }
+            glBufferData(GL_ARRAY_BUFFER, instanceCount * 3 * sizeof(float), sorted, GL_STREAM_DRAW);
+
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glBeginQuery(GL_TIME_ELAPSED, query);
+            trianglesPerFrame = 0;
+            for (size_t l = 0; l < lods.level_count; l++) {
+                GLsizei count = (GLsizei)(bucketStart[l + 1] - bucketStart[l]);
+                if (count == 0) continue;
+                glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float),
+                                      (void*)(bucketStart[l] * 3 * sizeof(float)));
+                glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)lods.levels[l].index_count, GL_UNSIGNED_INT,
+                                        (void*)(lods.levels[l].first_index * sizeof(unsigned int)), count);
+                trianglesPerFrame += lods.levels[l].index_count / 3 * (size_t)count;
+            }
+            glEndQuery(GL_TIME_ELAPSED);
+
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+            if (frame > 0) {    // the first frame warms up
+                gpuSeconds += elapsed * 1e-9;
+            }
+        }
+
+        double ms = gpuSeconds * 1e3 / BENCH_FRAMES;
+        snprintf(line, sizeof(line), "%-8s %12.2f %12.2f %14.1f\n", useLods ? "lod" : "full", ms,
+                 trianglesPerFrame * 1e-6, trianglesPerFrame * 1e-6 / (ms * 1e-3));
+        fputs(line, stdout);
+        fputs(line, report);
+    }
+
+    fclose(report);
+    printf("Results written to %s\n", BENCH_OUTPUT);
+
+    glDeleteQueries(1, &query);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ebo);
+    glDeleteBuffers(1, &instanceVbo);
+    glDeleteProgram(program);
+    utils_mesh_lods_free(&lods);
+    utils_mesh_free(&sphere);
+    free(offsets);
+    free(sorted);
+    free(levelOf);
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,332 @@
+// Microbenchmark for the Utils.c math backends (native, cglm, raymath)
+//
+// Utils.c picks its backend at compile time, so this program is built against the native
+// Utils.c and calls cglm and raymath directly, exactly the way the Utils.c wrappers do.
+// Every backend runs the same randomized inputs; results are compared against a reference
+// computed in double precision and rounded once to float.
+//
+//   gcc -O2 -march=native bench_math.c Utils.c -o bench_math -lm
+//   gcc -O2 -march=native -DBENCH_WITH_CGLM -DBENCH_WITH_RAYMATH bench_math.c Utils.c -o bench_math -lm
+//
+// Add -DUTILS_BATCH_THREADS -pthread to time the threaded native-batch path.
+//
+// Results are printed and written to bench_output.txt.
+
+#define _POSIX_C_SOURCE 199309L
+#include "Utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+
+#ifdef BENCH_WITH_CGLM
+#include <cglm/cglm.h>
+#endif
+
+#ifdef BENCH_WITH_RAYMATH
+#define RAYMATH_STATIC_INLINE
+#include <raymath.h>
+#endif
+
+#define BENCH_COUNT 65536   // matrices per batch
+#define BENCH_ROUNDS 32     // timed passes over the batch
+#define BENCH_OUTPUT "bench_output.txt"
+
+typedef enum {
+    OP_MULTIPLY,
+    OP_TRANSLATE,
+    OP_ROTATE,
+    OP_PERSPECTIVE,
+    OP_IDENTITY,
+    OP_COUNT
+} BenchOp;
+
+static const char* op_names[OP_COUNT] = {
+    "multiply", "translate", "rotate", "perspective", "identity"
+};
+
+typedef struct {
+    const char* name;
+    int multiply_only;   // only has its own path for multiply
+    void (*run)(BenchOp op, const float* a, const float* b, const float* params, float* out, size_t count);
+} Backend;
+
+// Inputs shared by all backends
+static float* input_a;
+static float* input_b;
+static float* input_params;   // 4 floats per matrix: angle/fovy, x/aspect, y/near, z/far
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Distance in units in the last place between two floats, NaN/inf count as maximal
+static uint32_t ulp_distance(float a, float b) {
+    if (isnan(a) || isnan(b) || isinf(a) || isinf(b)) {
+        return a == b ? 0 : UINT32_MAX;
+    }
+    int32_t ia, ib;
+    memcpy(&ia, &a, sizeof(ia));
+    memcpy(&ib, &b, sizeof(ib));
+    // Map the sign-magnitude representation onto a monotonic integer line
+    if (ia < 0) ia = INT32_MIN - ia;
+    if (ib < 0) ib = INT32_MIN - ib;
+    int64_t d = (int64_t)ia - (int64_t)ib;
+    return (uint32_t)(d < 0 ? -d : d);
+}
+
+// Column-major reference for every operation, computed in double and rounded once at the end
+static void run_reference(BenchOp op, const float* a, const float* b, const float* params, float* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const float* ma = a + i * 16;
+        const float* p = params + i * 4;
+        double rhs[16] = { 1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 1.0 };
+        double m[16];
+        switch (op) {
+            case OP_MULTIPLY:
+                for (int k = 0; k < 16; k++) rhs[k] = b[i * 16 + k];
+                break;
+            case OP_TRANSLATE:
+                rhs[12] = p[1];
+                rhs[13] = p[2];
+                rhs[14] = p[3];
+                break;
+            case OP_ROTATE: {
+                double magnitude = sqrt((double)p[1] * p[1] + (double)p[2] * p[2] + (double)p[3] * p[3]);
+                double nx = p[1] / magnitude, ny = p[2] / magnitude, nz = p[3] / magnitude;
+                double s = sin(p[0]), c = cos(p[0]), t = 1.0 - c;
+                rhs[0] = nx*nx*t+c;    rhs[1] = ny*nx*t+nz*s; rhs[2]  = nz*nx*t-ny*s;
+                rhs[4] = nx*ny*t-nz*s; rhs[5] = ny*ny*t+c;    rhs[6]  = nz*ny*t+nx*s;
+                rhs[8] = nx*nz*t+ny*s; rhs[9] = ny*nz*t-nx*s; rhs[10] = nz*nz*t+c;
+                break;
+            }
+            default:
+                break;
+        }
+        if (op == OP_PERSPECTIVE) {
+            double f = 1.0 / tan(p[0] / 2.0);
+            double nf = 1.0 / ((double)p[2] - p[3]);
+            memset(m, 0, sizeof(m));
+            m[0] = f / p[1];
+            m[5] = f;
+            m[10] = ((double)p[3] + p[2]) * nf;
+            m[11] = -1.0;
+            m[14] = 2.0 * p[3] * p[2] * nf;
+        } else if (op == OP_IDENTITY) {
+            memcpy(m, rhs, sizeof(m));
+        } else {
+            // out = a * rhs, which is what translate and rotate do to the copied input
+            for (int col = 0; col < 4; col++) {
+                for (int row = 0; row < 4; row++) {
+                    double sum = 0.0;
+                    for (int k = 0; k < 4; k++) {
+                        sum += (double)ma[k * 4 + row] * rhs[col * 4 + k];
+                    }
+                    m[col * 4 + row] = sum;
+                }
+            }
+        }
+        for (int k = 0; k < 16; k++) {
+            out[i * 16 + k] = (float)m[k];
+        }
+    }
+}
+
+static void run_native(BenchOp op, const float* a, const float* b, const float* params, float* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        float* m = out + i * 16;
+        const float* p = params + i * 4;
+        switch (op) {
+            case OP_MULTIPLY:
+                utils_matrix_multiply((float*)a + i * 16, (float*)b + i * 16, m);
+                break;
+            case OP_TRANSLATE:
+                memcpy(m, a + i * 16, 16 * sizeof(float));
+                utils_matrix_translate(m, p[1], p[2], p[3]);
+                break;
+            case OP_ROTATE:
+                memcpy(m, a + i * 16, 16 * sizeof(float));
+                utils_matrix_rotate(m, p[0], p[1], p[2], p[3]);
+                break;
+            case OP_PERSPECTIVE:
+                utils_matrix_perspective(m, p[0], p[1], p[2], p[3]);
+                break;
+            case OP_IDENTITY:
+                utils_matrix_identity(m);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static void run_native_batch(BenchOp op, const float* a, const float* b, const float* params, float* out, size_t count) {
+    (void)op;
+    (void)params;
+    utils_matrix_multiply_batch(a, b, out, count);
+}
+
+#ifdef BENCH_WITH_CGLM
+static void run_cglm(BenchOp op, const float* a, const float* b, const float* params, float* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        float* m = out + i * 16;
+        const float* p = params + i * 4;
+        switch (op) {
+            case OP_MULTIPLY:
+                glm_mat4_mul((vec4*)(a + i * 16), (vec4*)(b + i * 16), (vec4*)m);
+                break;
+            case OP_TRANSLATE:
+                memcpy(m, a + i * 16, 16 * sizeof(float));
+                glm_translate((vec4*)m, (vec3){p[1], p[2], p[3]});
+                break;
+            case OP_ROTATE:
+                memcpy(m, a + i * 16, 16 * sizeof(float));
+                glm_rotate((vec4*)m, p[0], (vec3){p[1], p[2], p[3]});
+                break;
+            case OP_PERSPECTIVE:
+                glm_perspective(p[0], p[1], p[2], p[3], (vec4*)m);
+                break;
+            case OP_IDENTITY:
+                glm_mat4_identity((vec4*)m);
+                break;
+            default:
+                break;
+        }
+    }
+}
+#endif
+
+#ifdef BENCH_WITH_RAYMATH
+static void run_raymath(BenchOp op, const float* a, const float* b, const float* params, float* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        Matrix* m = (Matrix*)(out + i * 16);
+        const Matrix* ma = (const Matrix*)(a + i * 16);
+        const Matrix* mb = (const Matrix*)(b + i * 16);
+        const float* p = params + i * 4;
+        switch (op) {
+            case OP_MULTIPLY:
+                *m = MatrixMultiply(*ma, *mb);
+                break;
+            case OP_TRANSLATE:
+                *m = MatrixMultiply(*ma, MatrixTranslate(p[1], p[2], p[3]));
+                break;
+            case OP_ROTATE:
+                *m = MatrixMultiply(*ma, MatrixRotate((Vector3){p[1], p[2], p[3]}, p[0]));
+                break;
+            case OP_PERSPECTIVE:
+                *m = MatrixPerspective(p[0] * RAD2DEG, p[1], p[2], p[3]);
+                break;
+            case OP_IDENTITY:
+                *m = MatrixIdentity();
+                break;
+            default:
+                break;
+        }
+    }
+}
+#endif
+
+static const Backend backends[] = {
+    { "native", 0, run_native },
+    { "native-batch", 1, run_native_batch },
+#ifdef BENCH_WITH_CGLM
+    { "cglm", 0, run_cglm },
+#endif
+#ifdef BENCH_WITH_RAYMATH
+    { "raymath", 0, run_raymath },
+#endif
+};
+
+#define BACKEND_COUNT (sizeof(backends) / sizeof(backends[0]))
+
+static void fill_inputs(void) {
+    utils_random_seed(1234);
+    for (size_t i = 0; i < BENCH_COUNT * 16; i++) {
+        input_a[i] = utils_random_float(-2.0f, 2.0f);
+        input_b[i] = utils_random_float(-2.0f, 2.0f);
+    }
+    for (size_t i = 0; i < BENCH_COUNT; i++) {
+        float* p = input_params + i * 4;
+        p[0] = utils_random_float(0.1f, 3.0f);   // angle or fovy (radians)
+        p[1] = utils_random_float(0.5f, 2.0f);   // x or aspect
+        p[2] = utils_random_float(0.01f, 1.0f);  // y or near
+        p[3] = utils_random_float(10.0f, 1000.0f); // z or far
+    }
+}
+
+int main(void) {
+    size_t bytes = BENCH_COUNT * 16 * sizeof(float);
+    input_a = utils_aligned_alloc(32, bytes);
+    input_b = utils_aligned_alloc(32, bytes);
+    input_params = utils_aligned_alloc(32, BENCH_COUNT * 4 * sizeof(float));
+    float* reference = utils_aligned_alloc(32, bytes);
+    float* output = utils_aligned_alloc(32, bytes);
+    if (!input_a || !input_b || !input_params || !reference || !output) {
+        fprintf(stderr, "Failed to allocate benchmark buffers\n");
+        return 1;
+    }
+    fill_inputs();
+
+    FILE* report = fopen(BENCH_OUTPUT, "w");
+    if (report == NULL) {
+        fprintf(stderr, "Failed to open %s for writing\n", BENCH_OUTPUT);
+        return 1;
+    }
+
+    char line[256];
+    snprintf(line, sizeof(line), "Math backend benchmark: %d matrices x %d rounds\n", BENCH_COUNT, BENCH_ROUNDS);
+    fputs(line, stdout);
+    fputs(line, report);
+    snprintf(line, sizeof(line), "%-12s %-14s %10s %14s %14s %12s\n",
+             "operation", "backend", "ns/op", "Mops/s", "max ULP", "max abs err");
+    fputs(line, stdout);
+    fputs(line, report);
+
+    for (int op = 0; op < OP_COUNT; op++) {
+        // Divergence is measured against the double-precision reference, so native is scored too
+        run_reference((BenchOp)op, input_a, input_b, input_params, reference, BENCH_COUNT);
+
+        for (size_t b = 0; b < BACKEND_COUNT; b++) {
+            if (backends[b].multiply_only && op != OP_MULTIPLY) {
+                continue;
+            }
+            // One warm-up pass, then timed rounds
+            backends[b].run((BenchOp)op, input_a, input_b, input_params, output, BENCH_COUNT);
+            double start = now_seconds();
+            for (int r = 0; r < BENCH_ROUNDS; r++) {
+                backends[b].run((BenchOp)op, input_a, input_b, input_params, output, BENCH_COUNT);
+            }
+            double elapsed = now_seconds() - start;
+
+            uint32_t max_ulp = 0;
+            double max_abs = 0.0;
+            for (size_t i = 0; i < BENCH_COUNT * 16; i++) {
+                uint32_t ulp = ulp_distance(output[i], reference[i]);
+                double abs_err = fabs((double)output[i] - (double)reference[i]);
+                if (ulp > max_ulp) max_ulp = ulp;
+                if (abs_err > max_abs) max_abs = abs_err;
+            }
+
+            double ops = (double)BENCH_COUNT * BENCH_ROUNDS;
+            snprintf(line, sizeof(line), "%-12s %-14s %10.2f %14.2f %14u %12.3g\n",
+                     op_names[op], backends[b].name, elapsed * 1e9 / ops, ops / elapsed * 1e-6,
+                     (unsigned int)max_ulp, max_abs);
+            fputs(line, stdout);
+            fputs(line, report);
+        }
+    }
+
+    fclose(report);
+    printf("Results written to %s\n", BENCH_OUTPUT);
+
+    utils_aligned_free(input_a);
+    utils_aligned_free(input_b);
+    utils_aligned_free(input_params);
+    utils_aligned_free(reference);
+    utils_aligned_free(output);
+    return 0;
+}
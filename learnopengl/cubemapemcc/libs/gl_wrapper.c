@@ -4,26 +4,217 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#include <stdint.h>
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+#define GLW_HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// Extension entry points, resolved by glw_load_extensions and NULL until then (or when the
+// context lacks the feature). gl2ext.h supplies their types and tokens; the core and
+// suffixed functions share signatures. WebGL2 has none of them.
+#ifndef __EMSCRIPTEN__
+#include <GLES2/gl2ext.h>
+
+// Persistent mapping needs glBufferStorage: core in desktop 4.4, an extension on GLES
+#define GLW_HAVE_BUFFER_STORAGE
+static PFNGLBUFFERSTORAGEEXTPROC glw_buffer_storage;
+
+// Base vertex draws: core in GLES 3.2 and desktop 3.2, an EXT or OES extension on older GLES
+#define GLW_HAVE_BASE_VERTEX
+static PFNGLDRAWELEMENTSBASEVERTEXEXTPROC glw_draw_elements_base_vertex;
+
+// Multi-draw indirect: core in desktop 4.3, an extension on GLES 3.1
+#define GLW_HAVE_MULTI_DRAW_INDIRECT
+static PFNGLMULTIDRAWELEMENTSINDIRECTEXTPROC glw_multi_draw_elements_indirect;
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F  // core in GLES 3.1, not in gl3.h or gl2ext.h
+#endif
+
+// KHR_debug: core in GLES 3.2 and desktop 4.3, KHR-suffixed on older GLES
+#define GLW_HAVE_DEBUG_OUTPUT
+static PFNGLDEBUGMESSAGECALLBACKKHRPROC glw_debug_message_callback;
+static PFNGLDEBUGMESSAGECONTROLKHRPROC glw_debug_message_control;
+#endif
 
 #define MAX_SHADER_LOG_SIZE 512
-#define MAX_UNIFORM_NAME 64
-#define UNIFORM_CACHE_SIZE 128
+#define UNIFORM_CACHE_INITIAL_CAPACITY 16
 
-typedef struct {
-    char name[MAX_UNIFORM_NAME];
-    GLint location;
-} UniformLocation;
+// State tracking
+// Every tracked value starts unknown; unknown never matches, so the first change is issued
+#define STATE_UNKNOWN 0xFFFFFFFFu
+
+enum { STATE_BUFFER_ARRAY, STATE_BUFFER_ELEMENT, STATE_BUFFER_UNIFORM, STATE_BUFFER_TARGETS };
+enum { STATE_TEXTURE_2D, STATE_TEXTURE_CUBE, STATE_TEXTURE_3D, STATE_TEXTURE_2D_ARRAY, STATE_TEXTURE_TARGETS };
 
 typedef struct {
-    UniformLocation locations[UNIFORM_CACHE_SIZE];
-    int count;
-} UniformCache;
+    GLuint program;
+    GLuint vao;
+    GLuint buffers[STATE_BUFFER_TARGETS];
+    GLuint active_unit;
+    GLuint textures[GLW_MAX_TEXTURE_UNITS][STATE_TEXTURE_TARGETS];
+    GLuint depth_test;
+    GLuint depth_func;
+    GLuint blend;
+    GLuint blend_src;
+    GLuint blend_dst;
+} GLState;
+
+static GLState gl_state;
+static bool gl_state_initialized = false;
+static GLWStateStats state_stats = {0};
+
+static GLState* state(void) {
+    if (!gl_state_initialized) {
+        glw_invalidate_state();
+    }
+    return &gl_state;
+}
+
+// Records a transition; returns true if the GL call must be issued
+static bool state_update(GLuint* tracked, GLuint value) {
+    if (*tracked == value) {
+        state_stats.elided++;
+        return false;
+    }
+    *tracked = value;
+    state_stats.issued++;
+    return true;
+}
+
+static int state_buffer_index(GLenum target) {
+    switch (target) {
+        case GL_ARRAY_BUFFER: return STATE_BUFFER_ARRAY;
+        case GL_ELEMENT_ARRAY_BUFFER: return STATE_BUFFER_ELEMENT;
+        case GL_UNIFORM_BUFFER: return STATE_BUFFER_UNIFORM;
+        default: return -1;
+    }
+}
+
+static int state_texture_index(GLenum target) {
+    switch (target) {
+        case GL_TEXTURE_2D: return STATE_TEXTURE_2D;
+        case GL_TEXTURE_CUBE_MAP: return STATE_TEXTURE_CUBE;
+        case GL_TEXTURE_3D: return STATE_TEXTURE_3D;
+        case GL_TEXTURE_2D_ARRAY: return STATE_TEXTURE_2D_ARRAY;
+        default: return -1;
+    }
+}
+
+void glw_invalidate_state(void) {
+    memset(&gl_state, 0xFF, sizeof(gl_state));
+    gl_state_initialized = true;
+}
+
+void glw_bind_program(GLuint program) {
+    if (state_update(&state()->program, program)) {
+        glUseProgram(program);
+    }
+}
+
+void glw_bind_vertex_array(GLuint vao) {
+    if (state_update(&state()->vao, vao)) {
+        glBindVertexArray(vao);
+        // The element buffer binding belongs to the VAO
+        gl_state.buffers[STATE_BUFFER_ELEMENT] = STATE_UNKNOWN;
+    }
+}
+
+void glw_bind_buffer(GLenum target, GLuint buffer) {
+    int index = state_buffer_index(target);
+    if (index < 0) {
+        state_stats.issued++;
+        glBindBuffer(target, buffer);
+    } else if (state_update(&state()->buffers[index], buffer)) {
+        glBindBuffer(target, buffer);
+    }
+}
+
+// Binds on whichever unit is active, without changing it
+static void bind_texture_target(GLenum target, GLuint texture) {
+    GLState* tracked = state();
+    int index = state_texture_index(target);
+    if (index < 0 || tracked->active_unit >= GLW_MAX_TEXTURE_UNITS) {
+        state_stats.issued++;
+        glBindTexture(target, texture);
+        if (index >= 0) {
+            // Unknown unit: nothing can be recorded, and nothing tracked may still hold
+            for (int unit = 0; unit < GLW_MAX_TEXTURE_UNITS; unit++) {
+                tracked->textures[unit][index] = STATE_UNKNOWN;
+            }
+        }
+        return;
+    }
+    if (state_update(&tracked->textures[tracked->active_unit][index], texture)) {
+        glBindTexture(target, texture);
+    }
+}
+
+void glw_bind_texture_unit(GLuint unit, GLenum target, GLuint texture) {
+    if (state_update(&state()->active_unit, unit)) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+    bind_texture_target(target, texture);
+}
+
+void glw_set_depth_test(bool enabled) {
+    if (state_update(&state()->depth_test, enabled)) {
+        if (enabled) glEnable(GL_DEPTH_TEST); else glDisable(GL_DEPTH_TEST);
+    }
+}
 
-static UniformCache uniform_cache = {0};
+void glw_set_depth_func(GLenum func) {
+    if (state_update(&state()->depth_func, func)) {
+        glDepthFunc(func);
+    }
+}
+
+void glw_set_blend(bool enabled) {
+    if (state_update(&state()->blend, enabled)) {
+        if (enabled) glEnable(GL_BLEND); else glDisable(GL_BLEND);
+    }
+}
+
+void glw_set_blend_func(GLenum src_factor, GLenum dst_factor) {
+    GLState* tracked = state();
+    if (tracked->blend_src == src_factor && tracked->blend_dst == dst_factor) {
+        state_stats.elided++;
+        return;
+    }
+    tracked->blend_src = src_factor;
+    tracked->blend_dst = dst_factor;
+    state_stats.issued++;
+    glBlendFunc(src_factor, dst_factor);
+}
+
+void glw_get_state_stats(GLWStateStats* out_stats) {
+    *out_stats = state_stats;
+}
+
+void glw_reset_state_stats(void) {
+    state_stats = (GLWStateStats){0};
+}
+
+// Deleted objects leave their bindings in an unknown state
+static void state_forget(GLuint* tracked, int count, GLuint name) {
+    for (int i = 0; i < count; i++) {
+        if (tracked[i] == name) tracked[i] = STATE_UNKNOWN;
+    }
+}
 
 // Shader compilation and linking
-static GLWrapperError compile_shader(GLuint shader, const char* source) {
-    glShaderSource(shader, 1, &source, NULL);
+// length < 0 means source is NUL-terminated
+static GLWrapperError compile_shader(GLuint shader, const char* source, GLint length) {
+    glShaderSource(shader, 1, &source, length < 0 ? NULL : &length);
     glCompileShader(shader);
 
     GLint success;
@@ -37,20 +228,201 @@ static GLWrapperError compile_shader(GLuint shader, const char* source) {
     return GL_WRAPPER_SUCCESS;
 }
 
-GLWrapperError glw_create_shader(const char* vertex_source, const char* fragment_source, GLWShader* out_shader) {
+// Program binary cache
+// Linked programs are stored as <dir>/<key>.bin, where the key hashes both sources and the
+// GL vendor/renderer/version strings. Anything that does not match exactly is recompiled.
+// WebGL exposes no binary formats, so under emscripten this is always a miss.
+#define PROGRAM_CACHE_MAGIC 0x43425047u   // "GPBC"
+#define PROGRAM_CACHE_VERSION 1u
+#define PROGRAM_CACHE_MAX_PATH 512
+// Room for the directory plus "/<16 hex digits>.bin" and its terminator
+#define PROGRAM_CACHE_PATH_SIZE (PROGRAM_CACHE_MAX_PATH + 21)
+#define FNV1A64_OFFSET 0xCBF29CE484222325ull
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;
+    uint32_t length;
+    uint64_t key;
+    uint64_t checksum;
+} ProgramCacheHeader;
+
+static char program_cache_dir[PROGRAM_CACHE_MAX_PATH] = GLW_PROGRAM_CACHE_DEFAULT_DIR;
+static bool program_cache_enabled = true;
+
+static uint64_t fnv1a64(uint64_t hash, const void* data, size_t length) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+// WebGL2 has no program binaries; even querying the format count raises GL_INVALID_ENUM
+static bool program_cache_supported(void) {
+#ifdef __EMSCRIPTEN__
+    return false;
+#else
+    if (!program_cache_enabled) return false;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+#endif
+}
+
+static uint64_t program_cache_key(const char* vertex_source, size_t vertex_length,
+                                  const char* fragment_source, size_t fragment_length) {
+    uint64_t hash = FNV1A64_OFFSET;
+    const GLenum driver_strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    for (int i = 0; i < 3; i++) {
+        const char* str = (const char*)glGetString(driver_strings[i]);
+        if (str) hash = fnv1a64(hash, str, strlen(str) + 1);
+    }
+    uint64_t length = vertex_length;
+    hash = fnv1a64(hash, &length, sizeof(length));
+    hash = fnv1a64(hash, vertex_source, vertex_length);
+    length = fragment_length;
+    hash = fnv1a64(hash, &length, sizeof(length));
+    return fnv1a64(hash, fragment_source, fragment_length);
+}
+
+static void program_cache_path(uint64_t key, char* path, size_t size) {
+    snprintf(path, size, "%s/%016llx.bin", program_cache_dir, (unsigned long long)key);
+}
+
+static GLuint program_cache_load(uint64_t key) {
+    if (!program_cache_supported()) return 0;
+
+    char path[PROGRAM_CACHE_PATH_SIZE];
+    program_cache_path(key, path, sizeof(path));
+    FILE* probe = fopen(path, "rb");
+    if (!probe) return 0;
+    fclose(probe);
+
+    GLWFileView view;
+    if (glw_file_view_open(path, &view) != GL_WRAPPER_SUCCESS) return 0;
+
+    GLuint program = 0;
+    ProgramCacheHeader header;
+    if (view.length >= sizeof(header)) {
+        memcpy(&header, view.data, sizeof(header));
+        const char* blob = view.data + sizeof(header);
+        if (header.magic == PROGRAM_CACHE_MAGIC && header.version == PROGRAM_CACHE_VERSION &&
+            header.key == key && header.length == view.length - sizeof(header) &&
+            header.checksum == fnv1a64(FNV1A64_OFFSET, blob, header.length)) {
+            program = glCreateProgram();
+            glProgramBinary(program, (GLenum)header.format, blob, (GLsizei)header.length);
+            GLint linked = 0;
+            glGetProgramiv(program, GL_LINK_STATUS, &linked);
+            if (!linked) {
+                glDeleteProgram(program);
+                program = 0;
+            }
+        }
+    }
+    glw_file_view_close(&view);
+
+    if (!program) {
+        glw_log("Discarding stale program cache entry: %s\n", path);
+        remove(path);
+    }
+    return program;
+}
+
+static void program_cache_store(GLuint program, uint64_t key) {
+    if (!program_cache_supported()) return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+    char* blob = (char*)malloc((size_t)length);
+    if (!blob) return;
+
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, blob);
+    if (written <= 0) {
+        free(blob);
+        return;
+    }
+
+    ProgramCacheHeader header = {
+        .magic = PROGRAM_CACHE_MAGIC,
+        .version = PROGRAM_CACHE_VERSION,
+        .format = (uint32_t)format,
+        .length = (uint32_t)written,
+        .key = key,
+        .checksum = fnv1a64(FNV1A64_OFFSET, blob, (size_t)written)
+    };
+
+#ifdef _WIN32
+    _mkdir(program_cache_dir);
+#else
+    mkdir(program_cache_dir, 0755);
+#endif
+
+    // Write under a temporary name and rename, so readers never see a partial entry
+    char path[PROGRAM_CACHE_PATH_SIZE];
+    char tmp_path[PROGRAM_CACHE_PATH_SIZE + 4];
+    program_cache_path(key, path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE* file = fopen(tmp_path, "wb");
+    if (file) {
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  fwrite(blob, 1, (size_t)written, file) == (size_t)written;
+        ok = (fclose(file) == 0) && ok;
+#ifdef _WIN32
+        if (ok) remove(path);
+#endif
+        if (!ok || rename(tmp_path, path) != 0) {
+            glw_log("Failed to write program cache entry: %s\n", path);
+            remove(tmp_path);
+        }
+    }
+    free(blob);
+}
+
+void glw_program_cache_set_dir(const char* dir) {
+    if (!dir) {
+        program_cache_enabled = false;
+        return;
+    }
+    snprintf(program_cache_dir, sizeof(program_cache_dir), "%s", dir);
+    program_cache_enabled = true;
+}
+
+static GLWrapperError create_shader(const char* vertex_source, GLint vertex_length,
+                                    const char* fragment_source, GLint fragment_length, GLWShader* out_shader) {
     GLWrapperError error = GL_WRAPPER_SUCCESS;
+    *out_shader = (GLWShader){0};
+    if (vertex_length < 0) vertex_length = (GLint)strlen(vertex_source);
+    if (fragment_length < 0) fragment_length = (GLint)strlen(fragment_source);
+
+    uint64_t key = program_cache_key(vertex_source, (size_t)vertex_length, fragment_source, (size_t)fragment_length);
+    GLuint cached = program_cache_load(key);
+    if (cached) {
+        // No shader objects exist for a cached program; glDeleteShader(0) is a no-op
+        *out_shader = (GLWShader){ .program = cached };
+        return GL_WRAPPER_SUCCESS;
+    }
+
     out_shader->vertex_shader = glCreateShader(GL_VERTEX_SHADER);
     out_shader->fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
 
-    error = compile_shader(out_shader->vertex_shader, vertex_source);
+    error = compile_shader(out_shader->vertex_shader, vertex_source, vertex_length);
     if (error != GL_WRAPPER_SUCCESS) return error;
 
-    error = compile_shader(out_shader->fragment_shader, fragment_source);
+    error = compile_shader(out_shader->fragment_shader, fragment_source, fragment_length);
     if (error != GL_WRAPPER_SUCCESS) return error;
 
     out_shader->program = glCreateProgram();
     glAttachShader(out_shader->program, out_shader->vertex_shader);
     glAttachShader(out_shader->program, out_shader->fragment_shader);
+    if (program_cache_supported()) {
+        glProgramParameteri(out_shader->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     glLinkProgram(out_shader->program);
 
     GLint success;
@@ -62,10 +434,38 @@ GLWrapperError glw_create_shader(const char* vertex_source, const char* fragment
         return GL_WRAPPER_ERROR_SHADER_LINKING;
     }
 
+    program_cache_store(out_shader->program, key);
     return GL_WRAPPER_SUCCESS;
 }
 
+GLWrapperError glw_create_shader(const char* vertex_source, const char* fragment_source, GLWShader* out_shader) {
+    return create_shader(vertex_source, -1, fragment_source, -1, out_shader);
+}
+
+GLWrapperError glw_create_shader_from_files(const char* vertex_path, const char* fragment_path, GLWShader* out_shader) {
+    GLWFileView vertex_view, fragment_view;
+    GLWrapperError error = glw_file_view_open(vertex_path, &vertex_view);
+    if (error != GL_WRAPPER_SUCCESS) return error;
+
+    error = glw_file_view_open(fragment_path, &fragment_view);
+    if (error != GL_WRAPPER_SUCCESS) {
+        glw_file_view_close(&vertex_view);
+        return error;
+    }
+
+    error = create_shader(vertex_view.data, (GLint)vertex_view.length,
+                          fragment_view.data, (GLint)fragment_view.length, out_shader);
+    glw_file_view_close(&vertex_view);
+    glw_file_view_close(&fragment_view);
+    return error;
+}
+
 void glw_delete_shader(GLWShader* shader) {
+    for (int i = 0; i < shader->uniform_capacity; i++) {
+        free(shader->uniforms[i].name);
+    }
+    free(shader->uniforms);
+    state_forget(&state()->program, 1, shader->program);
     glDeleteShader(shader->vertex_shader);
     glDeleteShader(shader->fragment_shader);
     glDeleteProgram(shader->program);
@@ -73,151 +473,383 @@ void glw_delete_shader(GLWShader* shader) {
 }
 
 void glw_use_shader(const GLWShader* shader) {
-    glUseProgram(shader->program);
+    glw_bind_program(shader->program);
 }
 
 // Uniform handling
-static GLint get_uniform_location(GLWShader* shader, const char* name) {
-    for (int i = 0; i < uniform_cache.count; i++) {
-        if (strcmp(uniform_cache.locations[i].name, name) == 0) {
-            return uniform_cache.locations[i].location;
+// FNV-1a; 0 is reserved for empty slots
+GLWUniformName glw_uniform_name(const char* name) {
+    uint32_t hash = 2166136261u;
+    for (const char* c = name; *c; c++) {
+        hash ^= (unsigned char)*c;
+        hash *= 16777619u;
+    }
+    return (GLWUniformName){ .name = name, .hash = hash ? hash : 1u };
+}
+
+// Linear probing; capacity is a power of two and never more than 3/4 full
+static GLWUniformSlot* uniform_slot(GLWUniformSlot* slots, int capacity, uint32_t hash, const char* name) {
+    uint32_t mask = (uint32_t)capacity - 1;
+    for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+        GLWUniformSlot* slot = &slots[i];
+        if (slot->hash == 0 || (slot->hash == hash && strcmp(slot->name, name) == 0)) {
+            return slot;
+        }
+    }
+}
+
+static bool uniform_cache_grow(GLWShader* shader) {
+    int capacity = shader->uniform_capacity ? shader->uniform_capacity * 2 : UNIFORM_CACHE_INITIAL_CAPACITY;
+    GLWUniformSlot* slots = calloc((size_t)capacity, sizeof(GLWUniformSlot));
+    if (!slots) return false;
+
+    for (int i = 0; i < shader->uniform_capacity; i++) {
+        GLWUniformSlot* old = &shader->uniforms[i];
+        if (old->hash) {
+            *uniform_slot(slots, capacity, old->hash, old->name) = *old;
+        }
+    }
+    free(shader->uniforms);
+    shader->uniforms = slots;
+    shader->uniform_capacity = capacity;
+    return true;
+}
+
+// Returns the cached slot, or NULL (with *out_location still set) if it could not be cached
+static GLWUniformSlot* get_uniform(GLWShader* shader, GLWUniformName uniform, GLint* out_location) {
+    const char* name = uniform.name;
+    uint32_t hash = uniform.hash;
+    if (shader->uniform_count > 0) {
+        GLWUniformSlot* slot = uniform_slot(shader->uniforms, shader->uniform_capacity, hash, name);
+        if (slot->hash) {
+            *out_location = slot->location;
+            return slot;
         }
     }
 
     GLint location = glGetUniformLocation(shader->program, name);
+    *out_location = location;
     if (location == -1) {
         glw_log("Warning: Uniform '%s' not found in shader program %u\n", name, shader->program);
-    } else if (uniform_cache.count < UNIFORM_CACHE_SIZE) {
-        strncpy(uniform_cache.locations[uniform_cache.count].name, name, MAX_UNIFORM_NAME - 1);
-        uniform_cache.locations[uniform_cache.count].location = location;
-        uniform_cache.count++;
     }
 
-    return location;
+    if ((shader->uniform_count + 1) * 4 > shader->uniform_capacity * 3 && !uniform_cache_grow(shader)) {
+        return NULL;
+    }
+    char* copy = malloc(strlen(name) + 1);
+    if (!copy) return NULL;
+    strcpy(copy, name);
+
+    GLWUniformSlot* slot = uniform_slot(shader->uniforms, shader->uniform_capacity, hash, name);
+    *slot = (GLWUniformSlot){ .hash = hash, .location = location, .name = copy };
+    shader->uniform_count++;
+    return slot;
 }
 
-GLWrapperError glw_set_uniform_1i(GLWShader* shader, const char* name, int value) {
-    GLint location = get_uniform_location(shader, name);
+static GLWUniformStats uniform_stats = {0};
+
+// Compares against the shadow copy and records the new value; false means skip the upload
+static bool uniform_changed(GLWUniformSlot* slot, const void* value, int size) {
+    if (slot) {
+        if (slot->value_size == size && memcmp(slot->value, value, (size_t)size) == 0) {
+            uniform_stats.skipped++;
+            return false;
+        }
+        memcpy(slot->value, value, (size_t)size);
+        slot->value_size = size;
+    }
+    uniform_stats.issued++;
+    return true;
+}
+
+void glw_get_uniform_stats(GLWUniformStats* out_stats) {
+    *out_stats = uniform_stats;
+}
+
+void glw_reset_uniform_stats(void) {
+    uniform_stats = (GLWUniformStats){0};
+}
+
+GLWrapperError glw_set_uniform_1i_hashed(GLWShader* shader, GLWUniformName uniform, int value) {
+    GLint location;
+    GLWUniformSlot* slot = get_uniform(shader, uniform, &location);
     if (location == -1) return GL_WRAPPER_ERROR_SHADER_LINKING;
-    glUseProgram(shader->program);
+    if (!uniform_changed(slot, &value, (int)sizeof(value))) return GL_WRAPPER_SUCCESS;
+    glw_bind_program(shader->program);
     glUniform1i(location, value);
     glw_check_error("glw_set_uniform_1i");
     return GL_WRAPPER_SUCCESS;
 }
 
-GLWrapperError glw_set_uniform_1f(GLWShader* shader, const char* name, float value) {
-    GLint location = get_uniform_location(shader, name);
+GLWrapperError glw_set_uniform_1f_hashed(GLWShader* shader, GLWUniformName uniform, float value) {
+    GLint location;
+    GLWUniformSlot* slot = get_uniform(shader, uniform, &location);
     if (location == -1) return GL_WRAPPER_ERROR_SHADER_LINKING;
-    glUseProgram(shader->program);
+    if (!uniform_changed(slot, &value, (int)sizeof(value))) return GL_WRAPPER_SUCCESS;
+    glw_bind_program(shader->program);
     glUniform1f(location, value);
     glw_check_error("glw_set_uniform_1f");
     return GL_WRAPPER_SUCCESS;
 }
 
-GLWrapperError glw_set_uniform_vec2(GLWShader* shader, const char* name, vec2 value) {
-    GLint location = get_uniform_location(shader, name);
+GLWrapperError glw_set_uniform_vec2_hashed(GLWShader* shader, GLWUniformName uniform, vec2 value) {
+    GLint location;
+    GLWUniformSlot* slot = get_uniform(shader, uniform, &location);
     if (location == -1) return GL_WRAPPER_ERROR_SHADER_LINKING;
-    glUseProgram(shader->program);
+    if (!uniform_changed(slot, value, (int)sizeof(vec2))) return GL_WRAPPER_SUCCESS;
+    glw_bind_program(shader->program);
     glUniform2fv(location, 1, value);
     glw_check_error("glw_set_uniform_vec2");
     return GL_WRAPPER_SUCCESS;
 }
 
-GLWrapperError glw_set_uniform_vec3(GLWShader* shader, const char* name, vec3 value) {
-    GLint location = get_uniform_location(shader, name);
+GLWrapperError glw_set_uniform_vec3_hashed(GLWShader* shader, GLWUniformName uniform, vec3 value) {
+    GLint location;
+    GLWUniformSlot* slot = get_uniform(shader, uniform, &location);
     if (location == -1) return GL_WRAPPER_ERROR_SHADER_LINKING;
-    glUseProgram(shader->program);
+    if (!uniform_changed(slot, value, (int)sizeof(vec3))) return GL_WRAPPER_SUCCESS;
+    glw_bind_program(shader->program);
     glUniform3fv(location, 1, value);
     glw_check_error("glw_set_uniform_vec3");
     return GL_WRAPPER_SUCCESS;
 }
 
-GLWrapperError glw_set_uniform_vec4(GLWShader* shader, const char* name, vec4 value) {
-    GLint location = get_uniform_location(shader, name);
+GLWrapperError glw_set_uniform_vec4_hashed(GLWShader* shader, GLWUniformName uniform, vec4 value) {
+    GLint location;
+    GLWUniformSlot* slot = get_uniform(shader, uniform, &location);
     if (location == -1) return GL_WRAPPER_ERROR_SHADER_LINKING;
-    glUseProgram(shader->program);
+    if (!uniform_changed(slot, value, (int)sizeof(vec4))) return GL_WRAPPER_SUCCESS;
+    glw_bind_program(shader->program);
     glUniform4fv(location, 1, value);
     glw_check_error("glw_set_uniform_vec4");
     return GL_WRAPPER_SUCCESS;
 }
 
-GLWrapperError glw_set_uniform_mat3(GLWShader* shader, const char* name, mat3 value) {
-    GLint location = get_uniform_location(shader, name);
+GLWrapperError glw_set_uniform_mat3_hashed(GLWShader* shader, GLWUniformName uniform, mat3 value) {
+    GLint location;
+    GLWUniformSlot* slot = get_uniform(shader, uniform, &location);
     if (location == -1) return GL_WRAPPER_ERROR_SHADER_LINKING;
-    glUseProgram(shader->program);
+    if (!uniform_changed(slot, value, (int)sizeof(mat3))) return GL_WRAPPER_SUCCESS;
+    glw_bind_program(shader->program);
     glUniformMatrix3fv(location, 1, GL_FALSE, (float*)value);
     glw_check_error("glw_set_uniform_mat3");
     return GL_WRAPPER_SUCCESS;
 }
 
-GLWrapperError glw_set_uniform_mat4(GLWShader* shader, const char* name, mat4 value) {
-    GLint location = get_uniform_location(shader, name);
+GLWrapperError glw_set_uniform_mat4_hashed(GLWShader* shader, GLWUniformName uniform, mat4 value) {
+    GLint location;
+    GLWUniformSlot* slot = get_uniform(shader, uniform, &location);
     if (location == -1) return GL_WRAPPER_ERROR_SHADER_LINKING;
-    glUseProgram(shader->program);
+    if (!uniform_changed(slot, value, (int)sizeof(mat4))) return GL_WRAPPER_SUCCESS;
+    glw_bind_program(shader->program);
     glUniformMatrix4fv(location, 1, GL_FALSE, (float*)value);
     glw_check_error("glw_set_uniform_mat4");
     return GL_WRAPPER_SUCCESS;
 }
 
+GLWrapperError glw_set_uniform_1i(GLWShader* shader, const char* name, int value) {
+    return glw_set_uniform_1i_hashed(shader, glw_uniform_name(name), value);
+}
+
+GLWrapperError glw_set_uniform_1f(GLWShader* shader, const char* name, float value) {
+    return glw_set_uniform_1f_hashed(shader, glw_uniform_name(name), value);
+}
+
+GLWrapperError glw_set_uniform_vec2(GLWShader* shader, const char* name, vec2 value) {
+    return glw_set_uniform_vec2_hashed(shader, glw_uniform_name(name), value);
+}
+
+GLWrapperError glw_set_uniform_vec3(GLWShader* shader, const char* name, vec3 value) {
+    return glw_set_uniform_vec3_hashed(shader, glw_uniform_name(name), value);
+}
+
+GLWrapperError glw_set_uniform_vec4(GLWShader* shader, const char* name, vec4 value) {
+    return glw_set_uniform_vec4_hashed(shader, glw_uniform_name(name), value);
+}
+
+GLWrapperError glw_set_uniform_mat3(GLWShader* shader, const char* name, mat3 value) {
+    return glw_set_uniform_mat3_hashed(shader, glw_uniform_name(name), value);
+}
+
+GLWrapperError glw_set_uniform_mat4(GLWShader* shader, const char* name, mat4 value) {
+    return glw_set_uniform_mat4_hashed(shader, glw_uniform_name(name), value);
+}
+
+// Vertex layouts
+GLsizei glw_vertex_attrib_size(const GLWVertexAttrib* attrib) {
+    if (attrib->components < 1 || attrib->components > 4) {
+        return 0;
+    }
+    switch (attrib->type) {
+        case GL_FLOAT:
+        case GL_INT:
+        case GL_UNSIGNED_INT:
+            return attrib->components * 4;
+        case GL_HALF_FLOAT:
+        case GL_SHORT:
+        case GL_UNSIGNED_SHORT:
+            return attrib->components * 2;
+        case GL_BYTE:
+        case GL_UNSIGNED_BYTE:
+            return attrib->components;
+        case GL_INT_2_10_10_10_REV:
+        case GL_UNSIGNED_INT_2_10_10_10_REV:
+            return attrib->components == 4 ? 4 : 0;
+        default:
+            return 0;
+    }
+}
+
+static GLWrapperError validate_layout(const GLWVertexLayout* layout) {
+    if (layout->stream_count < 1 || layout->stream_count > GLW_MAX_VERTEX_STREAMS ||
+        layout->attrib_count < 1 || layout->attrib_count > GLW_MAX_VERTEX_ATTRIBS) {
+        glw_log("Vertex layout: %d streams, %d attributes\n", layout->stream_count, layout->attrib_count);
+        return GL_WRAPPER_ERROR_INVALID_ARGUMENT;
+    }
+    for (int i = 0; i < layout->attrib_count; i++) {
+        const GLWVertexAttrib* attrib = &layout->attribs[i];
+        GLsizei size = glw_vertex_attrib_size(attrib);
+        if (size == 0 || attrib->location >= GLW_MAX_VERTEX_ATTRIBS ||
+            attrib->stream < 0 || attrib->stream >= layout->stream_count ||
+            attrib->offset + size > (GLuint)layout->strides[attrib->stream]) {
+            glw_log("Vertex layout: attribute %d (location %u) does not fit its stream\n", i, attrib->location);
+            return GL_WRAPPER_ERROR_INVALID_ARGUMENT;
+        }
+    }
+    return GL_WRAPPER_SUCCESS;
+}
+
+// Elements a stream holds: vertices, or instances for streams read with a divisor
+static int stream_element_count(const GLWVertexLayout* layout, int stream, int vertex_count, int instance_count) {
+    GLuint divisor = 0;
+    for (int i = 0; i < layout->attrib_count; i++) {
+        if (layout->attribs[i].stream == stream && layout->attribs[i].divisor > divisor) {
+            divisor = layout->attribs[i].divisor;
+        }
+    }
+    return divisor ? (int)((instance_count + divisor - 1) / divisor) : vertex_count;
+}
+
+// Points the layout's attributes for one stream at the bound GL_ARRAY_BUFFER, starting at
+// base bytes. Attribute pointers capture the buffer bound at the time of the call.
+static void set_attrib_pointers(const GLWVertexLayout* layout, int stream, GLintptr base) {
+    for (int i = 0; i < layout->attrib_count; i++) {
+        const GLWVertexAttrib* attrib = &layout->attribs[i];
+        if (attrib->stream != stream) continue;
+        glVertexAttribPointer(attrib->location, attrib->components, attrib->type,
+                              attrib->normalized ? GL_TRUE : GL_FALSE, layout->strides[stream],
+                              (const void*)(uintptr_t)(base + attrib->offset));
+        glEnableVertexAttribArray(attrib->location);
+        glVertexAttribDivisor(attrib->location, attrib->divisor);
+    }
+}
+
 // Mesh management
-GLWrapperError glw_create_mesh(float* vertices, int vertex_count, unsigned int* indices, int index_count, int stride, GLWMesh* out_mesh) {
+GLWrapperError glw_create_mesh_layout(const GLWVertexLayout* layout, const void* const* streams,
+                                      int vertex_count, int instance_count,
+                                      unsigned int* indices, int index_count, GLWMesh* out_mesh) {
+    *out_mesh = (GLWMesh){0};
+    GLWrapperError error = validate_layout(layout);
+    if (error != GL_WRAPPER_SUCCESS) {
+        return error;
+    }
+
+    bool instanced = false;
+    for (int i = 0; i < layout->attrib_count; i++) {
+        instanced |= layout->attribs[i].divisor > 0;
+    }
+    if (instanced && instance_count < 1) {
+        return GL_WRAPPER_ERROR_INVALID_ARGUMENT;
+    }
+
     out_mesh->vertex_count = vertex_count;
     out_mesh->index_count = index_count;
+    out_mesh->instance_count = instanced ? instance_count : 0;
+    out_mesh->stream_count = layout->stream_count;
+    out_mesh->usage = GL_STATIC_DRAW;
 
     glGenVertexArrays(1, &out_mesh->vao);
-    glGenBuffers(1, &out_mesh->vbo);
-
-    glBindVertexArray(out_mesh->vao);
-
-    glBindBuffer(GL_ARRAY_BUFFER, out_mesh->vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertex_count * stride, vertices, GL_STATIC_DRAW);
+    glGenBuffers(layout->stream_count, out_mesh->vbos);
+    glw_bind_vertex_array(out_mesh->vao);
+
+    for (int s = 0; s < layout->stream_count; s++) {
+        int count = stream_element_count(layout, s, vertex_count, instance_count);
+        glw_bind_buffer(GL_ARRAY_BUFFER, out_mesh->vbos[s]);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)count * layout->strides[s], streams[s], GL_STATIC_DRAW);
+        set_attrib_pointers(layout, s, 0);
+        out_mesh->strides[s] = layout->strides[s];
+    }
 
     if (indices && index_count > 0) {
         glGenBuffers(1, &out_mesh->ebo);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, out_mesh->ebo);
+        glw_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, out_mesh->ebo);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_count * sizeof(unsigned int), indices, GL_STATIC_DRAW);
     }
 
-    // Set up vertex attributes based on stride
+    glw_log("Created mesh: VAO %u, %d vertices, %d instances, %d streams, %d attributes\n", out_mesh->vao,
+            vertex_count, out_mesh->instance_count, layout->stream_count, layout->attrib_count);
+
+    glw_bind_vertex_array(0);
+    glw_check_error("glw_create_mesh_layout");
+    return GL_WRAPPER_SUCCESS;
+}
+
+GLWrapperError glw_create_mesh(float* vertices, int vertex_count, unsigned int* indices, int index_count, int stride, GLWMesh* out_mesh) {
+    GLWVertexLayout layout = { .stream_count = 1, .strides = { stride } };
+    layout.attribs[layout.attrib_count++] = (GLWVertexAttrib){ .location = 0, .components = 3, .type = GL_FLOAT };
     if (stride == 5 * sizeof(float)) {  // For cube (position + texture coordinates)
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(1);
-    } else if (stride == 3 * sizeof(float)) {  // For skybox (position only)
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
-        glEnableVertexAttribArray(0);
+        layout.attribs[layout.attrib_count++] = (GLWVertexAttrib){
+            .location = 1, .components = 2, .type = GL_FLOAT, .offset = 3 * sizeof(float) };
+    } else if (stride != 3 * sizeof(float)) {  // Anything but the skybox (position only)
+        glw_log("glw_create_mesh: unsupported stride %d, use glw_create_mesh_layout\n", stride);
+        return GL_WRAPPER_ERROR_INVALID_ARGUMENT;
     }
 
-    printf("Creating mesh with %d vertices, stride: %d\n", vertex_count, stride);
-    printf("VAO: %u, VBO: %u\n", out_mesh->vao, out_mesh->vbo);
+    const void* streams[1] = { vertices };
+    GLWrapperError error = glw_create_mesh_layout(&layout, streams, vertex_count, 0, indices, index_count, out_mesh);
+    if (error != GL_WRAPPER_SUCCESS) {
+        return error;
+    }
 
-    // Print the first few vertices
-    printf("First few vertices:\n");
+#ifdef GL_WRAPPER_DEBUG
+    // Print the positions of the first few vertices
+    int floats_per_vertex = stride / (int)sizeof(float);
     for (int i = 0; i < 6 && i < vertex_count; i++) {
-        printf("%f %f %f\n", vertices[i*3], vertices[i*3+1], vertices[i*3+2]);
+        const float* v = vertices + i * floats_per_vertex;
+        glw_log("  vertex %d: %f %f %f\n", i, v[0], v[1], v[2]);
     }
-
-    glBindVertexArray(0);
+#endif
 
     return GL_WRAPPER_SUCCESS;
 }
 
 void glw_delete_mesh(GLWMesh* mesh) {
+    GLState* tracked = state();
+    state_forget(&tracked->vao, 1, mesh->vao);
+    for (int s = 0; s < mesh->stream_count; s++) {
+        state_forget(tracked->buffers, STATE_BUFFER_TARGETS, mesh->vbos[s]);
+    }
+    state_forget(tracked->buffers, STATE_BUFFER_TARGETS, mesh->ebo);
     if (mesh->vao) glDeleteVertexArrays(1, &mesh->vao);
-    if (mesh->vbo) glDeleteBuffers(1, &mesh->vbo);
+    if (mesh->stream_count) glDeleteBuffers(mesh->stream_count, mesh->vbos);
     if (mesh->ebo) glDeleteBuffers(1, &mesh->ebo);
     *mesh = (GLWMesh){0};
 }
 
+// The VAO stays bound afterwards; consecutive draws of the same mesh skip the rebind
 void glw_draw_mesh(const GLWMesh* mesh, GLenum draw_mode) {
-    glBindVertexArray(mesh->vao);
-    if (mesh->index_count > 0) {
+    glw_bind_vertex_array(mesh->vao);
+    if (mesh->instance_count > 0) {
+        if (mesh->index_count > 0) {
+            glDrawElementsInstanced(draw_mode, mesh->index_count, GL_UNSIGNED_INT, 0, mesh->instance_count);
+        } else {
+            glDrawArraysInstanced(draw_mode, 0, mesh->vertex_count, mesh->instance_count);
+        }
+    } else if (mesh->index_count > 0) {
         glDrawElements(draw_mode, mesh->index_count, GL_UNSIGNED_INT, 0);
     } else {
         glDrawArrays(draw_mode, 0, mesh->vertex_count);
     }
-    glBindVertexArray(0);
 }
 
 GLWrapperError glw_update_mesh_data(GLWMesh* mesh, float* vertices, int vertex_count, unsigned int* indices, int index_count) {
@@ -225,21 +857,820 @@ GLWrapperError glw_update_mesh_data(GLWMesh* mesh, float* vertices, int vertex_c
         return GL_WRAPPER_ERROR_INVALID_ARGUMENT;
     }
 
-    glBindVertexArray(mesh->vao);
+    glw_bind_vertex_array(mesh->vao);
 
-    glBindBuffer(GL_ARRAY_BUFFER, mesh->vbo);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, vertex_count * sizeof(float), vertices);
+    glw_bind_buffer(GL_ARRAY_BUFFER, mesh->vbos[0]);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)vertex_count * mesh->strides[0], vertices);
 
     if (indices && mesh->ebo) {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->ebo);
+        glw_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, mesh->ebo);
         glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, index_count * sizeof(unsigned int), indices);
     }
 
-    glBindVertexArray(0);
+    glw_bind_vertex_array(0);
 
     return GL_WRAPPER_SUCCESS;
 }
 
+// Streaming ring buffer
+// A partition whose fence has not signalled is waited on in slices of this many nanoseconds
+#define RING_FENCE_TIMEOUT 1000000
+
+// Capability queries deciding which entry points glw_load_extensions resolves
+#if defined(GLW_HAVE_BUFFER_STORAGE) || defined(GLW_HAVE_BASE_VERTEX) || \
+    defined(GLW_HAVE_MULTI_DRAW_INDIRECT) || defined(GLW_HAVE_DEBUG_OUTPUT)
+static bool has_extension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        if (strcmp((const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i), name) == 0) return true;
+    }
+    return false;
+}
+
+static bool is_gles(void) {
+    const char* version = (const char*)glGetString(GL_VERSION);
+    return version && strncmp(version, "OpenGL ES", 9) == 0;
+}
+#endif
+
+#ifdef GLW_HAVE_BUFFER_STORAGE
+static bool buffer_storage_supported(void) {
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (is_gles()) return has_extension("GL_EXT_buffer_storage");
+    return major * 10 + minor >= 44 || has_extension("GL_ARB_buffer_storage");
+}
+#endif
+
+#ifdef GLW_HAVE_BASE_VERTEX
+// The function name that carries base vertex draws on this context, or NULL
+static const char* base_vertex_function(void) {
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major * 10 + minor >= 32) return "glDrawElementsBaseVertex";
+    if (is_gles()) {
+        if (has_extension("GL_EXT_draw_elements_base_vertex")) return "glDrawElementsBaseVertexEXT";
+        if (has_extension("GL_OES_draw_elements_base_vertex")) return "glDrawElementsBaseVertexOES";
+        return NULL;
+    }
+    return has_extension("GL_ARB_draw_elements_base_vertex") ? "glDrawElementsBaseVertex" : NULL;
+}
+#endif
+
+#ifdef GLW_HAVE_MULTI_DRAW_INDIRECT
+static bool multi_draw_indirect_supported(void) {
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (is_gles()) {
+        // GLES 3.1 indirect commands require base_instance to be 0 without EXT_base_instance
+        return has_extension("GL_EXT_multi_draw_indirect") && has_extension("GL_EXT_base_instance");
+    }
+    return major * 10 + minor >= 43 ||
+           (has_extension("GL_ARB_multi_draw_indirect") && has_extension("GL_ARB_base_instance"));
+}
+#endif
+
+#ifdef GLW_HAVE_DEBUG_OUTPUT
+// Desktop KHR_debug uses the core names; only GLES before 3.2 suffixes them
+static const char* debug_output_suffix(void) {
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    bool es = is_gles();
+    if (major * 10 + minor >= (es ? 32 : 43)) return "";
+    if (!has_extension("GL_KHR_debug")) return NULL;
+    return es ? "KHR" : "";
+}
+#endif
+
+// Window-system lookups may hand out stubs for names the driver lacks, so only the name
+// the context actually supports is resolved
+void glw_load_extensions(GLWProcLoader loader) {
+#ifdef GLW_HAVE_BUFFER_STORAGE
+    // ARB_buffer_storage uses the core name
+    glw_buffer_storage = NULL;
+    if (buffer_storage_supported()) {
+        glw_buffer_storage = (PFNGLBUFFERSTORAGEEXTPROC)loader(is_gles() ? "glBufferStorageEXT" : "glBufferStorage");
+    }
+#endif
+#ifdef GLW_HAVE_BASE_VERTEX
+    const char* base_vertex = base_vertex_function();
+    glw_draw_elements_base_vertex = base_vertex ? (PFNGLDRAWELEMENTSBASEVERTEXEXTPROC)loader(base_vertex) : NULL;
+#endif
+#ifdef GLW_HAVE_MULTI_DRAW_INDIRECT
+    glw_multi_draw_elements_indirect = NULL;
+    if (multi_draw_indirect_supported()) {
+        glw_multi_draw_elements_indirect = (PFNGLMULTIDRAWELEMENTSINDIRECTEXTPROC)loader(
+            is_gles() ? "glMultiDrawElementsIndirectEXT" : "glMultiDrawElementsIndirect");
+    }
+#endif
+#ifdef GLW_HAVE_DEBUG_OUTPUT
+    glw_debug_message_callback = NULL;
+    glw_debug_message_control = NULL;
+    const char* suffix = debug_output_suffix();
+    if (suffix) {
+        char name[64];
+        snprintf(name, sizeof(name), "glDebugMessageCallback%s", suffix);
+        glw_debug_message_callback = (PFNGLDEBUGMESSAGECALLBACKKHRPROC)loader(name);
+        snprintf(name, sizeof(name), "glDebugMessageControl%s", suffix);
+        glw_debug_message_control = (PFNGLDEBUGMESSAGECONTROLKHRPROC)loader(name);
+    }
+#endif
+    (void)loader;
+}
+
+// Waits for and deletes *fence, if any. Returns whether the GPU had not finished with it yet.
+static bool wait_fence(GLsync* fence) {
+    if (!*fence) {
+        return false;
+    }
+    GLenum status = glClientWaitSync(*fence, 0, 0);
+    bool waited = status == GL_TIMEOUT_EXPIRED;
+    while (status == GL_TIMEOUT_EXPIRED) {
+        status = glClientWaitSync(*fence, GL_SYNC_FLUSH_COMMANDS_BIT, RING_FENCE_TIMEOUT);
+    }
+    glDeleteSync(*fence);
+    *fence = 0;
+    return waited;
+}
+
+GLWrapperError glw_ring_buffer_create(GLsizeiptr frame_size, GLWRingBuffer* out_ring) {
+    *out_ring = (GLWRingBuffer){0};
+    if (frame_size <= 0) {
+        return GL_WRAPPER_ERROR_INVALID_ARGUMENT;
+    }
+
+    // Uniform ranges need the driver's offset alignment; 16 also suits any vertex format
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    out_ring->alignment = alignment > 16 ? alignment : 16;
+    out_ring->frame_size = (frame_size + out_ring->alignment - 1) / out_ring->alignment * out_ring->alignment;
+    out_ring->frame = GLW_RING_FRAMES - 1;  // the first begin_frame moves to partition 0
+
+    // GL_COPY_WRITE_BUFFER is not state-tracked, so creating the ring disturbs no binding
+    glGenBuffers(1, &out_ring->buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, out_ring->buffer);
+
+#ifdef GLW_HAVE_BUFFER_STORAGE
+    if (glw_buffer_storage) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT_EXT | GL_MAP_COHERENT_BIT_EXT;
+        GLsizeiptr total = out_ring->frame_size * GLW_RING_FRAMES;
+        glw_buffer_storage(GL_COPY_WRITE_BUFFER, total, NULL, flags);
+        out_ring->data = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, total, flags);
+        out_ring->persistent = out_ring->data != NULL;
+        if (!out_ring->persistent) {
+            // Immutable storage cannot fall back to orphaning; start over with a new buffer
+            glDeleteBuffers(1, &out_ring->buffer);
+            glGenBuffers(1, &out_ring->buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, out_ring->buffer);
+        }
+    }
+#endif
+
+    if (!out_ring->persistent) {
+        // Orphaning already hands each frame fresh storage, so one partition is enough
+        glBufferData(GL_COPY_WRITE_BUFFER, out_ring->frame_size, NULL, GL_STREAM_DRAW);
+        out_ring->data = malloc(out_ring->frame_size);
+        if (!out_ring->data) {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            glDeleteBuffers(1, &out_ring->buffer);
+            *out_ring = (GLWRingBuffer){0};
+            return GL_WRAPPER_ERROR_MEMORY_ALLOCATION;
+        }
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    glw_log("Ring buffer %u: %ld bytes x %d frames, %s\n", out_ring->buffer, (long)out_ring->frame_size,
+            out_ring->persistent ? GLW_RING_FRAMES : 1, out_ring->persistent ? "persistent" : "orphaned");
+    glw_check_error("glw_ring_buffer_create");
+    return GL_WRAPPER_SUCCESS;
+}
+
+void glw_ring_buffer_delete(GLWRingBuffer* ring) {
+    for (int i = 0; i < GLW_RING_FRAMES; i++) {
+        if (ring->fences[i]) glDeleteSync(ring->fences[i]);
+    }
+    if (ring->buffer) {
+        GLState* tracked = state();
+        state_forget(tracked->buffers, STATE_BUFFER_TARGETS, ring->buffer);
+        if (ring->persistent) {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, ring->buffer);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &ring->buffer);
+    }
+    if (!ring->persistent) {
+        free(ring->data);
+    }
+    *ring = (GLWRingBuffer){0};
+}
+
+void glw_ring_buffer_begin_frame(GLWRingBuffer* ring) {
+    ring->head = 0;
+    if (!ring->persistent) {
+        return;
+    }
+
+    ring->frame = (ring->frame + 1) % GLW_RING_FRAMES;
+    // Normally signalled long ago; only a GPU more than GLW_RING_FRAMES behind blocks here
+    if (wait_fence(&ring->fences[ring->frame])) {
+        ring->fence_waits++;
+    }
+}
+
+GLWrapperError glw_ring_buffer_alloc(GLWRingBuffer* ring, GLsizeiptr size, GLWRingRange* out_range) {
+    GLsizeiptr start = (ring->head + ring->alignment - 1) / ring->alignment * ring->alignment;
+    if (size <= 0 || start + size > ring->frame_size) {
+        glw_log("Ring buffer %u: %ld bytes do not fit (%ld of %ld used)\n", ring->buffer,
+                (long)size, (long)ring->head, (long)ring->frame_size);
+        return GL_WRAPPER_ERROR_MEMORY_ALLOCATION;
+    }
+    ring->head = start + size;
+
+    GLintptr base = ring->persistent ? (GLintptr)ring->frame * ring->frame_size : 0;
+    out_range->offset = base + start;
+    out_range->size = size;
+    out_range->data = ring->data + out_range->offset;
+    return GL_WRAPPER_SUCCESS;
+}
+
+// Persistent mappings are coherent, so there is nothing to do; otherwise the storage is
+// orphaned and everything allocated so far is uploaded in one call. Draws issued before
+// a flush keep reading the storage they were issued with.
+void glw_ring_buffer_flush(GLWRingBuffer* ring) {
+    if (ring->persistent || ring->head == 0) {
+        return;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ring->buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, ring->frame_size, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, 0, ring->head, ring->data);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glw_check_error("glw_ring_buffer_flush");
+}
+
+void glw_ring_buffer_bind_range(GLWRingBuffer* ring, GLuint binding, const GLWRingRange* range) {
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, ring->buffer, range->offset, range->size);
+    // Indexed binds also replace the generic GL_UNIFORM_BUFFER binding
+    state()->buffers[STATE_BUFFER_UNIFORM] = ring->buffer;
+}
+
+void glw_ring_buffer_end_frame(GLWRingBuffer* ring) {
+    if (ring->persistent) {
+        ring->fences[ring->frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
+
+// Geometry pool
+#define POOL_RESTART_INDEX 0xFFFFFFFFu
+#define FREE_LIST_INITIAL_CAPACITY 16
+
+static bool free_list_init(GLWFreeList* list, GLuint total) {
+    *list = (GLWFreeList){0};
+    if (total == 0) {
+        return true;
+    }
+    list->ranges = malloc(FREE_LIST_INITIAL_CAPACITY * sizeof(GLWPoolRange));
+    if (!list->ranges) {
+        return false;
+    }
+    list->capacity = FREE_LIST_INITIAL_CAPACITY;
+    list->ranges[0] = (GLWPoolRange){ 0, total };
+    list->count = 1;
+    return true;
+}
+
+// First fit: takes count elements from the front of the lowest free range that holds them
+static bool free_list_alloc(GLWFreeList* list, GLuint count, GLuint* out_offset) {
+    if (count == 0) {
+        *out_offset = 0;
+        return true;
+    }
+    for (int i = 0; i < list->count; i++) {
+        GLWPoolRange* range = &list->ranges[i];
+        if (range->count < count) continue;
+        *out_offset = range->offset;
+        range->offset += count;
+        range->count -= count;
+        if (range->count == 0) {
+            memmove(range, range + 1, (list->count - i - 1) * sizeof(GLWPoolRange));
+            list->count--;
+        }
+        return true;
+    }
+    return false;
+}
+
+// Returns a range, merging it with the free ranges it touches
+static bool free_list_release(GLWFreeList* list, GLuint offset, GLuint count) {
+    if (count == 0) {
+        return true;
+    }
+    int lo = 0, hi = list->count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (list->ranges[mid].offset < offset) lo = mid + 1; else hi = mid;
+    }
+
+    bool merge_prev = lo > 0 && list->ranges[lo - 1].offset + list->ranges[lo - 1].count == offset;
+    bool merge_next = lo < list->count && offset + count == list->ranges[lo].offset;
+    if (merge_prev && merge_next) {
+        list->ranges[lo - 1].count += count + list->ranges[lo].count;
+        memmove(&list->ranges[lo], &list->ranges[lo + 1], (list->count - lo - 1) * sizeof(GLWPoolRange));
+        list->count--;
+    } else if (merge_prev) {
+        list->ranges[lo - 1].count += count;
+    } else if (merge_next) {
+        list->ranges[lo].offset = offset;
+        list->ranges[lo].count += count;
+    } else {
+        if (list->count == list->capacity) {
+            int capacity = list->capacity ? list->capacity * 2 : FREE_LIST_INITIAL_CAPACITY;
+            GLWPoolRange* ranges = realloc(list->ranges, capacity * sizeof(GLWPoolRange));
+            if (!ranges) {
+                return false;
+            }
+            list->ranges = ranges;
+            list->capacity = capacity;
+        }
+        memmove(&list->ranges[lo + 1], &list->ranges[lo], (list->count - lo) * sizeof(GLWPoolRange));
+        list->ranges[lo] = (GLWPoolRange){ offset, count };
+        list->count++;
+    }
+    return true;
+}
+
+
+GLWrapperError glw_geometry_pool_create(const GLWVertexLayout* layout, int vertex_capacity, int index_capacity,
+                                        GLWGeometryPool* out_pool) {
+    *out_pool = (GLWGeometryPool){0};
+    GLWrapperError error = validate_layout(layout);
+    if (error != GL_WRAPPER_SUCCESS) {
+        return error;
+    }
+    if (layout->stream_count != 1 || vertex_capacity < 1 || index_capacity < 0) {
+        return GL_WRAPPER_ERROR_INVALID_ARGUMENT;
+    }
+    for (int i = 0; i < layout->attrib_count; i++) {
+        if (layout->attribs[i].divisor > 0) {
+            glw_log("Geometry pool: attribute %d is instanced\n", i);
+            return GL_WRAPPER_ERROR_INVALID_ARGUMENT;
+        }
+    }
+
+    out_pool->stride = layout->strides[0];
+    out_pool->vertex_capacity = (GLuint)vertex_capacity;
+    out_pool->index_capacity = (GLuint)index_capacity;
+    if (!free_list_init(&out_pool->free_vertices, out_pool->vertex_capacity) ||
+        !free_list_init(&out_pool->free_indices, out_pool->index_capacity)) {
+        free(out_pool->free_vertices.ranges);
+        *out_pool = (GLWGeometryPool){0};
+        return GL_WRAPPER_ERROR_MEMORY_ALLOCATION;
+    }
+#ifdef GLW_HAVE_BASE_VERTEX
+    out_pool->base_vertex = glw_draw_elements_base_vertex != NULL;
+#endif
+
+    glGenVertexArrays(1, &out_pool->vao);
+    glGenBuffers(1, &out_pool->vbo);
+    glw_bind_vertex_array(out_pool->vao);
+
+    glw_bind_buffer(GL_ARRAY_BUFFER, out_pool->vbo);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertex_capacity * out_pool->stride, NULL, GL_STATIC_DRAW);
+    set_attrib_pointers(layout, 0, 0);
+
+    if (index_capacity > 0) {
+        glGenBuffers(1, &out_pool->ebo);
+        glw_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, out_pool->ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)index_capacity * sizeof(unsigned int), NULL, GL_STATIC_DRAW);
+    }
+
+    glw_log("Created geometry pool: VAO %u, %d vertices of %d bytes, %d indices, %s\n", out_pool->vao,
+            vertex_capacity, (int)out_pool->stride, index_capacity,
+            out_pool->base_vertex ? "base vertex" : "rebased indices");
+
+    glw_bind_vertex_array(0);
+    glw_check_error("glw_geometry_pool_create");
+    return GL_WRAPPER_SUCCESS;
+}
+
+void glw_geometry_pool_delete(GLWGeometryPool* pool) {
+    GLState* tracked = state();
+    state_forget(&tracked->vao, 1, pool->vao);
+    state_forget(tracked->buffers, STATE_BUFFER_TARGETS, pool->vbo);
+    state_forget(tracked->buffers, STATE_BUFFER_TARGETS, pool->ebo);
+    if (pool->vao) glDeleteVertexArrays(1, &pool->vao);
+    if (pool->vbo) glDeleteBuffers(1, &pool->vbo);
+    if (pool->ebo) glDeleteBuffers(1, &pool->ebo);
+    free(pool->free_vertices.ranges);
+    free(pool->free_indices.ranges);
+    *pool = (GLWGeometryPool){0};
+}
+
+GLWrapperError glw_geometry_pool_alloc(GLWGeometryPool* pool, const void* vertices, int vertex_count,
+                                       const unsigned int* indices, int index_count, GLWPoolMesh* out_mesh) {
+    *out_mesh = (GLWPoolMesh){0};
+    if (!vertices || vertex_count < 1 || index_count < 0 || (index_count > 0 && !indices)) {
+        return GL_WRAPPER_ERROR_INVALID_ARGUMENT;
+    }
+    // An out-of-range index would read another mesh's vertices
+    for (int i = 0; i < index_count; i++) {
+        if (indices[i] >= (unsigned int)vertex_count && indices[i] != POOL_RESTART_INDEX) {
+            glw_log("Geometry pool: index %d is %u, mesh has %d vertices\n", i, indices[i], vertex_count);
+            return GL_WRAPPER_ERROR_INVALID_ARGUMENT;
+        }
+    }
+
+    GLuint first_vertex, first_index;
+    if (!free_list_alloc(&pool->free_vertices, (GLuint)vertex_count, &first_vertex)) {
+        glw_log("Geometry pool %u: no room for %d vertices\n", pool->vao, vertex_count);
+        return GL_WRAPPER_ERROR_MEMORY_ALLOCATION;
+    }
+    if (!free_list_alloc(&pool->free_indices, (GLuint)index_count, &first_index)) {
+        free_list_release(&pool->free_vertices, first_vertex, (GLuint)vertex_count);
+        glw_log("Geometry pool %u: no room for %d indices\n", pool->vao, index_count);
+        return GL_WRAPPER_ERROR_MEMORY_ALLOCATION;
+    }
+
+    // Rebasing needs a copy; done before any upload so failure leaves the pool untouched
+    unsigned int* rebased = NULL;
+    if (index_count > 0 && !pool->base_vertex && first_vertex > 0) {
+        rebased = malloc(index_count * sizeof(unsigned int));
+        if (!rebased) {
+            free_list_release(&pool->free_vertices, first_vertex, (GLuint)vertex_count);
+            free_list_release(&pool->free_indices, first_index, (GLuint)index_count);
+            return GL_WRAPPER_ERROR_MEMORY_ALLOCATION;
+        }
+        for (int i = 0; i < index_count; i++) {
+            rebased[i] = indices[i] == POOL_RESTART_INDEX ? POOL_RESTART_INDEX : indices[i] + first_vertex;
+        }
+        indices = rebased;
+    }
+
+    glw_bind_vertex_array(pool->vao);
+    glw_bind_buffer(GL_ARRAY_BUFFER, pool->vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)first_vertex * pool->stride,
+                    (GLsizeiptr)vertex_count * pool->stride, vertices);
+    if (index_count > 0) {
+        glw_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, pool->ebo);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (GLintptr)first_index * sizeof(unsigned int),
+                        (GLsizeiptr)index_count * sizeof(unsigned int), indices);
+    }
+    glw_bind_vertex_array(0);
+    free(rebased);
+
+    out_mesh->base_vertex = (GLint)first_vertex;
+    out_mesh->vertex_count = vertex_count;
+    out_mesh->first_index = first_index;
+    out_mesh->index_count = index_count;
+    glw_check_error("glw_geometry_pool_alloc");
+    return GL_WRAPPER_SUCCESS;
+}
+
+void glw_geometry_pool_free(GLWGeometryPool* pool, GLWPoolMesh* mesh) {
+    // A failed release only loses the range to fragmentation
+    if (!free_list_release(&pool->free_vertices, (GLuint)mesh->base_vertex, (GLuint)mesh->vertex_count) ||
+        !free_list_release(&pool->free_indices, mesh->first_index, (GLuint)mesh->index_count)) {
+        glw_log("Geometry pool %u: free list allocation failed, range leaked\n", pool->vao);
+    }
+    *mesh = (GLWPoolMesh){0};
+}
+
+void glw_geometry_pool_draw(const GLWGeometryPool* pool, const GLWPoolMesh* mesh, GLenum draw_mode) {
+    glw_bind_vertex_array(pool->vao);
+    if (mesh->index_count == 0) {
+        glDrawArrays(draw_mode, mesh->base_vertex, mesh->vertex_count);
+        return;
+    }
+    const void* offset = (const void*)(uintptr_t)(mesh->first_index * sizeof(unsigned int));
+#ifdef GLW_HAVE_BASE_VERTEX
+    if (pool->base_vertex) {
+        glw_draw_elements_base_vertex(draw_mode, mesh->index_count, GL_UNSIGNED_INT, offset, mesh->base_vertex);
+        return;
+    }
+#endif
+    glDrawElements(draw_mode, mesh->index_count, GL_UNSIGNED_INT, offset);
+}
+
+// Draw lists
+
+GLWrapperError glw_draw_list_create(const GLWGeometryPool* pool, GLuint draw_id_location, int capacity,
+                                    GLWDrawList* out_list) {
+    *out_list = (GLWDrawList){0};
+    if (!pool->ebo || capacity < 1 || draw_id_location >= GLW_MAX_VERTEX_ATTRIBS) {
+        return GL_WRAPPER_ERROR_INVALID_ARGUMENT;
+    }
+    out_list->commands = malloc(capacity * sizeof(GLWDrawCommand));
+    if (!out_list->commands) {
+        return GL_WRAPPER_ERROR_MEMORY_ALLOCATION;
+    }
+    out_list->pool = pool;
+    out_list->capacity = capacity;
+    out_list->draw_id_location = draw_id_location;
+#ifdef GLW_HAVE_MULTI_DRAW_INDIRECT
+    out_list->multi_draw = pool->base_vertex && glw_multi_draw_elements_indirect != NULL;
+#endif
+
+    if (out_list->multi_draw) {
+        GLuint* ids = malloc(capacity * sizeof(GLuint));
+        if (!ids) {
+            free(out_list->commands);
+            *out_list = (GLWDrawList){0};
+            return GL_WRAPPER_ERROR_MEMORY_ALLOCATION;
+        }
+        for (int i = 0; i < capacity; i++) {
+            ids[i] = (GLuint)i;
+        }
+        glGenBuffers(1, &out_list->draw_id_buffer);
+        glGenBuffers(1, &out_list->indirect_buffer);
+
+        glw_bind_vertex_array(pool->vao);
+        glw_bind_buffer(GL_ARRAY_BUFFER, out_list->draw_id_buffer);
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(GLuint), ids, GL_STATIC_DRAW);
+        glVertexAttribIPointer(draw_id_location, 1, GL_UNSIGNED_INT, sizeof(GLuint), (const void*)0);
+        glVertexAttribDivisor(draw_id_location, 1);
+        glEnableVertexAttribArray(draw_id_location);
+        glw_bind_vertex_array(0);
+        free(ids);
+    }
+
+    glw_log("Created draw list: %d draws on pool VAO %u, %s\n", capacity, pool->vao,
+            out_list->multi_draw ? "multi-draw indirect" : "draw loop");
+    glw_check_error("glw_draw_list_create");
+    return GL_WRAPPER_SUCCESS;
+}
+
+void glw_draw_list_delete(GLWDrawList* list) {
+    if (list->draw_id_buffer) {
+        glw_bind_vertex_array(list->pool->vao);
+        glDisableVertexAttribArray(list->draw_id_location);
+        glw_bind_vertex_array(0);
+
+        GLState* tracked = state();
+        state_forget(tracked->buffers, STATE_BUFFER_TARGETS, list->draw_id_buffer);
+        glDeleteBuffers(1, &list->draw_id_buffer);
+    }
+    if (list->indirect_buffer) glDeleteBuffers(1, &list->indirect_buffer);
+    free(list->commands);
+    *list = (GLWDrawList){0};
+}
+
+void glw_draw_list_reset(GLWDrawList* list) {
+    list->count = 0;
+}
+
+int glw_draw_list_add(GLWDrawList* list, const GLWPoolMesh* mesh) {
+    if (list->count == list->capacity || mesh->index_count == 0) {
+        glw_log("Draw list: %s\n", mesh->index_count == 0 ? "mesh has no indices" : "full");
+        return -1;
+    }
+    int id = list->count++;
+    list->commands[id] = (GLWDrawCommand){
+        .count = (GLuint)mesh->index_count,
+        .instance_count = 1,
+        .first_index = mesh->first_index,
+        .base_vertex = list->pool->base_vertex ? mesh->base_vertex : 0,
+        .base_instance = (GLuint)id,
+    };
+    return id;
+}
+
+// The pool's VAO stays bound afterwards, like glw_geometry_pool_draw
+void glw_draw_list_submit(GLWDrawList* list, GLenum draw_mode) {
+    if (list->count == 0) {
+        return;
+    }
+    glw_bind_vertex_array(list->pool->vao);
+
+#ifdef GLW_HAVE_MULTI_DRAW_INDIRECT
+    if (list->multi_draw) {
+        // Commands are rewritten every frame; orphaning keeps the upload from waiting on the GPU
+        GLsizeiptr size = list->count * sizeof(GLWDrawCommand);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, list->indirect_buffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, list->capacity * sizeof(GLWDrawCommand), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, size, list->commands);
+        glw_multi_draw_elements_indirect(draw_mode, GL_UNSIGNED_INT, (const void*)0, list->count, 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glw_check_error("glw_draw_list_submit");
+        return;
+    }
+#endif
+
+    for (int i = 0; i < list->count; i++) {
+        const GLWDrawCommand* command = &list->commands[i];
+        const void* offset = (const void*)(uintptr_t)(command->first_index * sizeof(unsigned int));
+        glVertexAttribI4ui(list->draw_id_location, command->base_instance, 0, 0, 0);
+#ifdef GLW_HAVE_BASE_VERTEX
+        if (list->pool->base_vertex) {
+            glw_draw_elements_base_vertex(draw_mode, (GLsizei)command->count, GL_UNSIGNED_INT, offset,
+                                          command->base_vertex);
+            continue;
+        }
+#endif
+        glDrawElements(draw_mode, (GLsizei)command->count, GL_UNSIGNED_INT, offset);
+    }
+    glw_check_error("glw_draw_list_submit");
+}
+
+// Dynamic meshes
+static void dirty_range_add(GLWDirtyRange* range, int first, int end) {
+    if (range->first == range->end) {
+        range->first = first;
+        range->end = end;
+        return;
+    }
+    if (first < range->first) range->first = first;
+    if (end > range->end) range->end = end;
+}
+
+// Copies vertices [first, end) of the CPU copy into one region of the bound GL_ARRAY_BUFFER
+static void dynamic_mesh_upload(GLWDynamicMesh* mesh, int region, int first, int end) {
+    GLintptr offset = ((GLintptr)region * mesh->vertex_count + first) * mesh->stride;
+    GLsizeiptr size = (GLsizeiptr)(end - first) * mesh->stride;
+    const uint8_t* src = mesh->vertices + (size_t)first * mesh->stride;
+#ifndef __EMSCRIPTEN__
+    // The region's fence has signalled, so nothing reads it; skip the driver's own sync.
+    // WebGL has no buffer mapping, and its glBufferSubData copies anyway.
+    void* dst = glMapBufferRange(GL_ARRAY_BUFFER, offset, size,
+                                 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (dst) {
+        memcpy(dst, src, size);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        return;
+    }
+#endif
+    glBufferSubData(GL_ARRAY_BUFFER, offset, size, src);
+}
+
+GLWrapperError glw_dynamic_mesh_create(const GLWVertexLayout* layout, GLWDynamicMode mode,
+                                       const void* vertices, int vertex_count,
+                                       const unsigned int* indices, int index_count, GLWDynamicMesh* out_mesh) {
+    *out_mesh = (GLWDynamicMesh){0};
+    GLWrapperError error = validate_layout(layout);
+    if (error != GL_WRAPPER_SUCCESS) {
+        return error;
+    }
+    if (layout->stream_count != 1 || vertex_count < 1 || index_count < 0 || (index_count > 0 && !indices)) {
+        return GL_WRAPPER_ERROR_INVALID_ARGUMENT;
+    }
+    for (int i = 0; i < layout->attrib_count; i++) {
+        if (layout->attribs[i].divisor > 0) {
+            glw_log("Dynamic mesh: attribute %d is instanced\n", i);
+            return GL_WRAPPER_ERROR_INVALID_ARGUMENT;
+        }
+    }
+
+    out_mesh->mode = mode;
+#ifdef __EMSCRIPTEN__
+    // WebGL cannot block on a fence and its bufferSubData always copies, so rotating mode
+    // keeps one region and uploads its dirty range in place
+    out_mesh->region_count = 1;
+#else
+    out_mesh->region_count = mode == GLW_DYNAMIC_ROTATE ? GLW_DYNAMIC_REGIONS : 1;
+#endif
+    out_mesh->stride = layout->strides[0];
+    out_mesh->vertex_count = vertex_count;
+    out_mesh->index_count = index_count;
+
+    size_t bytes = (size_t)vertex_count * out_mesh->stride;
+    out_mesh->vertices = vertices ? malloc(bytes) : calloc(1, bytes);
+    if (!out_mesh->vertices) {
+        *out_mesh = (GLWDynamicMesh){0};
+        return GL_WRAPPER_ERROR_MEMORY_ALLOCATION;
+    }
+    if (vertices) {
+        memcpy(out_mesh->vertices, vertices, bytes);
+    }
+
+    // Every region starts with the initial vertices, so none is dirty yet
+    glGenBuffers(1, &out_mesh->vbo);
+    glGenVertexArrays(out_mesh->region_count, out_mesh->vaos);
+    glw_bind_buffer(GL_ARRAY_BUFFER, out_mesh->vbo);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(bytes * out_mesh->region_count), NULL,
+                 mode == GLW_DYNAMIC_ROTATE ? GL_DYNAMIC_DRAW : GL_STREAM_DRAW);
+    for (int r = 0; r < out_mesh->region_count; r++) {
+        glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)(r * bytes), (GLsizeiptr)bytes, out_mesh->vertices);
+    }
+
+    if (index_count > 0) {
+        glGenBuffers(1, &out_mesh->ebo);
+    }
+    for (int r = 0; r < out_mesh->region_count; r++) {
+        glw_bind_vertex_array(out_mesh->vaos[r]);
+        set_attrib_pointers(layout, 0, (GLintptr)(r * bytes));
+        if (out_mesh->ebo) {
+            glw_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, out_mesh->ebo);
+            if (r == 0) {
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)index_count * sizeof(unsigned int), indices,
+                             GL_STATIC_DRAW);
+            }
+        }
+    }
+
+    glw_log("Created dynamic mesh: VBO %u, %d vertices of %d bytes x %d regions, %s\n", out_mesh->vbo,
+            vertex_count, (int)out_mesh->stride, out_mesh->region_count,
+            mode == GLW_DYNAMIC_ROTATE ? "rotating" : "orphaned");
+
+    glw_bind_vertex_array(0);
+    glw_check_error("glw_dynamic_mesh_create");
+    return GL_WRAPPER_SUCCESS;
+}
+
+void glw_dynamic_mesh_delete(GLWDynamicMesh* mesh) {
+    GLState* tracked = state();
+    for (int r = 0; r < mesh->region_count; r++) {
+        if (mesh->fences[r]) glDeleteSync(mesh->fences[r]);
+        state_forget(&tracked->vao, 1, mesh->vaos[r]);
+    }
+    state_forget(tracked->buffers, STATE_BUFFER_TARGETS, mesh->vbo);
+    state_forget(tracked->buffers, STATE_BUFFER_TARGETS, mesh->ebo);
+
+    glDeleteVertexArrays(mesh->region_count, mesh->vaos);
+    glDeleteBuffers(1, &mesh->vbo);
+    if (mesh->ebo) glDeleteBuffers(1, &mesh->ebo);
+    free(mesh->vertices);
+    *mesh = (GLWDynamicMesh){0};
+}
+
+GLWrapperError glw_dynamic_mesh_write(GLWDynamicMesh* mesh, int first_vertex, int vertex_count, const void* data) {
+    if (first_vertex < 0 || vertex_count < 0 || first_vertex + vertex_count > mesh->vertex_count || !data) {
+        return GL_WRAPPER_ERROR_INVALID_ARGUMENT;
+    }
+    memcpy(mesh->vertices + (size_t)first_vertex * mesh->stride, data, (size_t)vertex_count * mesh->stride);
+    glw_dynamic_mesh_mark_dirty(mesh, first_vertex, vertex_count);
+    return GL_WRAPPER_SUCCESS;
+}
+
+// Every region has to catch up with the change before it is drawn again
+void glw_dynamic_mesh_mark_dirty(GLWDynamicMesh* mesh, int first_vertex, int vertex_count) {
+    int first = first_vertex < 0 ? 0 : first_vertex;
+    int end = first_vertex + vertex_count;
+    if (end > mesh->vertex_count) end = mesh->vertex_count;
+    if (first >= end) {
+        return;
+    }
+    for (int r = 0; r < mesh->region_count; r++) {
+        dirty_range_add(&mesh->dirty[r], first, end);
+    }
+}
+
+void glw_dynamic_mesh_flush(GLWDynamicMesh* mesh) {
+    GLWDirtyRange* dirty = &mesh->dirty[mesh->region];
+    if (mesh->mode == GLW_DYNAMIC_ORPHAN) {
+        if (dirty->first == dirty->end) {
+            return;
+        }
+        // Draws already issued keep the old storage; the whole mesh goes into the new one
+        glw_bind_buffer(GL_ARRAY_BUFFER, mesh->vbo);
+        GLsizeiptr bytes = (GLsizeiptr)mesh->vertex_count * mesh->stride;
+        glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, mesh->vertices);
+        *dirty = (GLWDirtyRange){0};
+        glw_check_error("glw_dynamic_mesh_flush");
+        return;
+    }
+
+    // Unchanged meshes keep drawing from the current region, which is already up to date
+    bool pending = false;
+    for (int r = 0; r < mesh->region_count; r++) {
+        pending |= mesh->dirty[r].first != mesh->dirty[r].end;
+    }
+    if (!pending) {
+        return;
+    }
+
+    // Fence the region the GPU may still be reading, then take the next one
+    if (mesh->region_count > 1) {
+        if (mesh->fences[mesh->region]) glDeleteSync(mesh->fences[mesh->region]);
+        mesh->fences[mesh->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        mesh->region = (mesh->region + 1) % mesh->region_count;
+        if (wait_fence(&mesh->fences[mesh->region])) {
+            mesh->fence_waits++;
+        }
+    }
+
+    dirty = &mesh->dirty[mesh->region];
+    if (dirty->first != dirty->end) {
+        glw_bind_buffer(GL_ARRAY_BUFFER, mesh->vbo);
+        dynamic_mesh_upload(mesh, mesh->region, dirty->first, dirty->end);
+        *dirty = (GLWDirtyRange){0};
+    }
+    glw_check_error("glw_dynamic_mesh_flush");
+}
+
+void glw_dynamic_mesh_draw(const GLWDynamicMesh* mesh, GLenum draw_mode) {
+    glw_bind_vertex_array(mesh->vaos[mesh->region]);
+    if (mesh->ebo) {
+        glDrawElements(draw_mode, mesh->index_count, GL_UNSIGNED_INT, 0);
+    } else {
+        glDrawArrays(draw_mode, 0, mesh->vertex_count);
+    }
+}
+
 // Texture management
 GLWrapperError glw_create_texture(unsigned char* data, int width, int height, GLenum format, GLenum internal_format, GLenum type, GLWTexture* out_texture) {
     out_texture->width = width;
@@ -249,7 +1680,7 @@ GLWrapperError glw_create_texture(unsigned char* data, int width, int height, GL
     out_texture->type = type;
 
     glGenTextures(1, &out_texture->id);
-    glBindTexture(GL_TEXTURE_2D, out_texture->id);
+    bind_texture_target(GL_TEXTURE_2D, out_texture->id);
     glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, format, type, data);
     glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -262,13 +1693,15 @@ GLWrapperError glw_create_texture(unsigned char* data, int width, int height, GL
 }
 
 void glw_delete_texture(GLWTexture* texture) {
+    if (texture->id) {
+        state_forget(&state()->textures[0][0], GLW_MAX_TEXTURE_UNITS * STATE_TEXTURE_TARGETS, texture->id);
+    }
     glDeleteTextures(1, &texture->id);
     *texture = (GLWTexture){0};
 }
 
 void glw_bind_texture(const GLWTexture* texture, GLenum texture_unit) {
-    glActiveTexture(GL_TEXTURE0 + texture_unit);
-    glBindTexture(texture->target, texture->id);
+    glw_bind_texture_unit(texture_unit, texture->target, texture->id);
 }
 
 
@@ -404,14 +1837,56 @@ const char* glw_error_string(GLWrapperError error) {
     }
 }
 
-void glw_check_error(const char* operation) {
+#if GLW_ERROR_CHECK_LEVEL >= 1
+// Errors are always printed here: reaching these checks means they were asked for
+static bool drain_errors(const char* operation) {
+    bool found = false;
     GLenum error;
     while ((error = glGetError()) != GL_NO_ERROR) {
-        glw_log("OpenGL error after %s: 0x%x\n", operation, error);
+        fprintf(stderr, "OpenGL error after %s: 0x%x\n", operation, error);
+        found = true;
     }
+    return found;
 }
+#endif
 
-GLWrapperError glw_read_file(const char* filename, char** out_content) {
+#if GLW_ERROR_CHECK_LEVEL >= 2
+void glw_check_error(const char* operation) {
+    drain_errors(operation);
+}
+#endif
+
+#if GLW_ERROR_CHECK_LEVEL >= 1
+bool glw_frame_check_errors(const char* label) {
+    return drain_errors(label);
+}
+#endif
+
+#ifdef GLW_HAVE_DEBUG_OUTPUT
+static void GL_APIENTRY debug_output_callback(GLenum source, GLenum type, GLuint id, GLenum severity,
+                                              GLsizei length, const GLchar* message, const void* user_param) {
+    (void)source; (void)id; (void)length; (void)user_param;
+    const char* level = severity == GL_DEBUG_SEVERITY_HIGH_KHR ? "high" :
+                        severity == GL_DEBUG_SEVERITY_MEDIUM_KHR ? "medium" : "low";
+    fprintf(stderr, "GL debug (%s%s): %s\n", type == GL_DEBUG_TYPE_ERROR_KHR ? "error, " : "", level, message);
+}
+#endif
+
+bool glw_enable_debug_output(void) {
+#ifdef GLW_HAVE_DEBUG_OUTPUT
+    if (!glw_debug_message_callback || !glw_debug_message_control) return false;
+    glEnable(GL_DEBUG_OUTPUT_KHR);
+    glw_debug_message_callback(debug_output_callback, NULL);
+    // Notifications are informational chatter (buffer placement and the like)
+    glw_debug_message_control(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION_KHR, 0, NULL, GL_FALSE);
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Reads the whole file into a NUL-terminated buffer and reports how many bytes it holds
+static GLWrapperError read_file_buffered(const char* filename, char** out_content, size_t* out_length) {
     FILE* file = fopen(filename, "rb");
     if (!file) {
         glw_log("Failed to open file: %s\nError: %s\n", filename, strerror(errno));
@@ -454,9 +1929,62 @@ GLWrapperError glw_read_file(const char* filename, char** out_content) {
     }
 
     (*out_content)[length] = '\0';
+    *out_length = read_length;
     fclose(file);
     return GL_WRAPPER_SUCCESS;
 }
+
+GLWrapperError glw_read_file(const char* filename, char** out_content) {
+    size_t length;
+    return read_file_buffered(filename, out_content, &length);
+}
+
+GLWrapperError glw_file_view_open(const char* filename, GLWFileView* out_view) {
+    *out_view = (GLWFileView){0};
+
+#ifdef GLW_HAVE_MMAP
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        glw_log("Failed to open file: %s\nError: %s\n", filename, strerror(errno));
+        return GL_WRAPPER_ERROR_FILE_READ;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            close(fd);
+            out_view->data = (const char*)data;
+            out_view->length = (size_t)st.st_size;
+            out_view->mapped = true;
+            return GL_WRAPPER_SUCCESS;
+        }
+        glw_log("mmap failed for %s, reading instead\nError: %s\n", filename, strerror(errno));
+    }
+    close(fd);
+#endif
+
+    char* content = NULL;
+    size_t length = 0;
+    GLWrapperError error = read_file_buffered(filename, &content, &length);
+    if (error != GL_WRAPPER_SUCCESS) return error;
+    out_view->data = content;
+    out_view->length = length;
+    return GL_WRAPPER_SUCCESS;
+}
+
+void glw_file_view_close(GLWFileView* view) {
+    if (view->data) {
+#ifdef GLW_HAVE_MMAP
+        if (view->mapped) {
+            munmap((void*)view->data, view->length);
+        } else
+#endif
+        {
+            free((void*)view->data);
+        }
+    }
+    *view = (GLWFileView){0};
+}
 /*
 GLWrapperError glw_read_file(const char* filename, char** out_content) {
     FILE* file = fopen(filename, "rb");
@@ -6,6 +6,8 @@
 #include <errno.h>
 #include <cglm/cglm.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 // Error handling
 typedef enum {
@@ -20,18 +22,81 @@ typedef enum {
     GL_WRAPPER_ERROR_INVALID_ARGUMENT
 } GLWrapperError;
 
+// State tracking
+// The wrapper remembers the GL state it last set and skips calls that would not change it.
+// Call glw_invalidate_state() after code that changes GL state behind its back (raylib's
+// rlgl in BeginDrawing/EndDrawing, or raw gl* calls), so the next change is always issued.
+#define GLW_MAX_TEXTURE_UNITS 16
+
+void glw_bind_program(GLuint program);
+void glw_bind_vertex_array(GLuint vao);
+void glw_bind_buffer(GLenum target, GLuint buffer);
+void glw_bind_texture_unit(GLuint unit, GLenum target, GLuint texture);
+void glw_set_depth_test(bool enabled);
+void glw_set_depth_func(GLenum func);
+void glw_set_blend(bool enabled);
+void glw_set_blend_func(GLenum src_factor, GLenum dst_factor);
+void glw_invalidate_state(void);
+
+// Call counters: issued reached the driver, elided matched the tracked state
+typedef struct {
+    uint64_t issued;
+    uint64_t elided;
+} GLWStateStats;
+
+void glw_get_state_stats(GLWStateStats* out_stats);
+void glw_reset_state_stats(void);
+
+// Extension entry points
+// <GLES3/gl3.h> declares nothing past GLES 3.0, and not every GL library exports the rest,
+// so optional features are resolved at runtime. Call glw_load_extensions once the context
+// is current, with the window system's lookup (glfwGetProcAddress, eglGetProcAddress,
+// SDL_GL_GetProcAddress). Without it, and always on WebGL, the GLES 3.0 fallbacks are used.
+typedef void (*GLWProc)(void);
+typedef GLWProc (*GLWProcLoader)(const char* name);
+
+void glw_load_extensions(GLWProcLoader loader);
+
 // Shader management
+// Uniform locations are cached per program in an open-addressed table keyed by name hash.
+// Each slot also shadows the last value uploaded through glw_set_uniform_*, and identical
+// uploads are skipped; set uniforms of a GLWShader only through the wrapper.
+typedef struct {
+    uint32_t hash;      // 0 marks an empty slot
+    GLint location;     // -1 is cached too, so missing uniforms are only queried once
+    char* name;
+    float value[16];    // last uploaded value, large enough for a mat4
+    int value_size;     // bytes in value, 0 until the first upload
+} GLWUniformSlot;
+
 typedef struct {
     GLuint program;
     GLuint vertex_shader;
     GLuint fragment_shader;
+    GLWUniformSlot* uniforms;
+    int uniform_capacity;   // power of two, grows as needed
+    int uniform_count;
 } GLWShader;
 
 GLWrapperError glw_create_shader(const char* vertex_source, const char* fragment_source, GLWShader* out_shader);
+GLWrapperError glw_create_shader_from_files(const char* vertex_path, const char* fragment_path, GLWShader* out_shader);
+
+// Program binary cache used by glw_create_shader*; NULL disables it
+#define GLW_PROGRAM_CACHE_DEFAULT_DIR "shader_cache"
+void glw_program_cache_set_dir(const char* dir);
 void glw_delete_shader(GLWShader* shader);
 void glw_use_shader(const GLWShader* shader);
 
-// Uniform setters (cached)
+// Names hashed once, at setup, for the *_hashed setters used per frame; the string must
+// outlive the handle, which is the case for literals
+typedef struct {
+    const char* name;
+    uint32_t hash;
+} GLWUniformName;
+
+GLWUniformName glw_uniform_name(const char* name);
+
+// Uniform setters (cached); the plain forms hash name on every call
 GLWrapperError glw_set_uniform_1i(GLWShader* shader, const char* name, int value);
 GLWrapperError glw_set_uniform_1f(GLWShader* shader, const char* name, float value);
 GLWrapperError glw_set_uniform_vec2(GLWShader* shader, const char* name, vec2 value);
@@ -39,22 +104,268 @@ GLWrapperError glw_set_uniform_vec3(GLWShader* shader, const char* name, vec3 va
 GLWrapperError glw_set_uniform_vec4(GLWShader* shader, const char* name, vec4 value);
 GLWrapperError glw_set_uniform_mat3(GLWShader* shader, const char* name, mat3 value);
 GLWrapperError glw_set_uniform_mat4(GLWShader* shader, const char* name, mat4 value);
+GLWrapperError glw_set_uniform_1i_hashed(GLWShader* shader, GLWUniformName uniform, int value);
+GLWrapperError glw_set_uniform_1f_hashed(GLWShader* shader, GLWUniformName uniform, float value);
+GLWrapperError glw_set_uniform_vec2_hashed(GLWShader* shader, GLWUniformName uniform, vec2 value);
+GLWrapperError glw_set_uniform_vec3_hashed(GLWShader* shader, GLWUniformName uniform, vec3 value);
+GLWrapperError glw_set_uniform_vec4_hashed(GLWShader* shader, GLWUniformName uniform, vec4 value);
+GLWrapperError glw_set_uniform_mat3_hashed(GLWShader* shader, GLWUniformName uniform, mat3 value);
+GLWrapperError glw_set_uniform_mat4_hashed(GLWShader* shader, GLWUniformName uniform, mat4 value);
+
+// Upload counters across all shaders: issued reached the driver, skipped matched the shadow copy
+typedef struct {
+    uint64_t issued;
+    uint64_t skipped;
+} GLWUniformStats;
+
+void glw_get_uniform_stats(GLWUniformStats* out_stats);
+void glw_reset_uniform_stats(void);
+
+// Vertex layouts
+// Each attribute reads from one of the layout's streams (a vertex buffer). Interleaved data
+// is one stream with several attributes; split data is one stream per attribute. Attributes
+// with a divisor advance per instance instead of per vertex; a mesh with any such attribute
+// is drawn instanced. Compact types are converted to float by the GPU: GL_HALF_FLOAT,
+// GL_BYTE/GL_SHORT (snorm when normalized), GL_UNSIGNED_BYTE/GL_UNSIGNED_SHORT (unorm when
+// normalized) and GL_INT_2_10_10_10_REV/GL_UNSIGNED_INT_2_10_10_10_REV (4 components).
+#define GLW_MAX_VERTEX_ATTRIBS 16   // the GLES3 minimum for GL_MAX_VERTEX_ATTRIBS
+#define GLW_MAX_VERTEX_STREAMS 4
+
+typedef struct {
+    GLuint location;
+    GLint components;   // 1-4
+    GLenum type;
+    bool normalized;
+    GLuint offset;      // bytes from the start of a vertex in its stream
+    int stream;         // index into GLWVertexLayout.strides
+    GLuint divisor;     // 0 per vertex, n to advance once every n instances
+} GLWVertexAttrib;
+
+typedef struct {
+    GLWVertexAttrib attribs[GLW_MAX_VERTEX_ATTRIBS];
+    int attrib_count;
+    GLsizei strides[GLW_MAX_VERTEX_STREAMS];
+    int stream_count;
+} GLWVertexLayout;
+
+// Bytes one attribute occupies in its stream, 0 for an unsupported type/component count
+GLsizei glw_vertex_attrib_size(const GLWVertexAttrib* attrib);
 
 // Buffer management
 typedef struct {
     GLuint vao;
-    GLuint vbo;
+    GLuint vbos[GLW_MAX_VERTEX_STREAMS];
+    GLsizei strides[GLW_MAX_VERTEX_STREAMS];
+    int stream_count;
     GLuint ebo;
     int vertex_count;
     int index_count;
+    int instance_count; // 0 unless the layout has instanced attributes
     GLenum usage;
 } GLWMesh;
 
+// Float-only shortcut: stride 5 floats is position + texcoord, 3 floats is position only
 GLWrapperError glw_create_mesh(float* vertices, int vertex_count, unsigned int* indices, int index_count, int stride, GLWMesh* out_mesh);
+// streams[i] holds vertex_count vertices of strides[i] bytes, or for instanced streams
+// ceil(instance_count / divisor) elements
+GLWrapperError glw_create_mesh_layout(const GLWVertexLayout* layout, const void* const* streams,
+                                      int vertex_count, int instance_count,
+                                      unsigned int* indices, int index_count, GLWMesh* out_mesh);
 void glw_delete_mesh(GLWMesh* mesh);
 void glw_draw_mesh(const GLWMesh* mesh, GLenum draw_mode);
+// Rewrites the start of stream 0 (vertex_count vertices of its stride) and of the indices in
+// place; the driver may stall if the GPU still reads them. Use GLWDynamicMesh per frame.
 GLWrapperError glw_update_mesh_data(GLWMesh* mesh, float* vertices, int vertex_count, unsigned int* indices, int index_count);
 
+// Dynamic meshes
+// Vertices rewritten every frame (animation, CPU deformation) without writing into storage
+// the GPU may still be reading. Writes go to a CPU copy and mark a dirty vertex range;
+// glw_dynamic_mesh_flush uploads once per frame, before the mesh is drawn.
+//   GLW_DYNAMIC_ROTATE: GLW_DYNAMIC_REGIONS copies of the vertices in one buffer, each with
+//     its own VAO. Each flush moves to the next region, waits on its fence (only a GPU more
+//     than GLW_DYNAMIC_REGIONS frames behind blocks) and uploads just the vertices changed
+//     since that region was last current. Suits partial updates. On WebGL, which cannot
+//     wait on fences, there is one region and its dirty range is updated in place.
+//   GLW_DYNAMIC_ORPHAN: one copy; each flush orphans the buffer and uploads every vertex.
+//     Suits meshes rewritten entirely every frame, and saves memory.
+// Indices are static. The layout must be a single per-vertex stream.
+//
+//   glw_dynamic_mesh_write(&mesh, first, count, data);   // any number of times
+//   glw_dynamic_mesh_flush(&mesh);                       // once, after the last write
+//   glw_dynamic_mesh_draw(&mesh, GL_TRIANGLES);
+#define GLW_DYNAMIC_REGIONS 3
+
+typedef enum {
+    GLW_DYNAMIC_ROTATE,
+    GLW_DYNAMIC_ORPHAN
+} GLWDynamicMode;
+
+typedef struct {
+    int first;                  // first dirty vertex
+    int end;                    // one past the last; first == end when clean
+} GLWDirtyRange;
+
+typedef struct {
+    GLWDynamicMode mode;
+    GLuint vbo;
+    GLuint ebo;
+    GLuint vaos[GLW_DYNAMIC_REGIONS];           // one per region, sharing the index buffer
+    GLsync fences[GLW_DYNAMIC_REGIONS];
+    GLWDirtyRange dirty[GLW_DYNAMIC_REGIONS];   // changes each region has not received yet
+    int region_count;
+    int region;                 // region draws read
+    GLsizei stride;
+    int vertex_count;
+    int index_count;
+    uint8_t* vertices;          // CPU copy; after writing to it directly, mark the range dirty
+    uint64_t fence_waits;       // flushes that had to wait for the GPU to release a region
+} GLWDynamicMesh;
+
+// vertices may be NULL to start zeroed; indices may be NULL for non-indexed drawing
+GLWrapperError glw_dynamic_mesh_create(const GLWVertexLayout* layout, GLWDynamicMode mode,
+                                       const void* vertices, int vertex_count,
+                                       const unsigned int* indices, int index_count, GLWDynamicMesh* out_mesh);
+void glw_dynamic_mesh_delete(GLWDynamicMesh* mesh);
+GLWrapperError glw_dynamic_mesh_write(GLWDynamicMesh* mesh, int first_vertex, int vertex_count, const void* data);
+void glw_dynamic_mesh_mark_dirty(GLWDynamicMesh* mesh, int first_vertex, int vertex_count);
+void glw_dynamic_mesh_flush(GLWDynamicMesh* mesh);
+// The current region's VAO stays bound afterwards, like glw_draw_mesh
+void glw_dynamic_mesh_draw(const GLWDynamicMesh* mesh, GLenum draw_mode);
+
+// Streaming ring buffer for data rewritten every frame (uniform blocks, dynamic vertices,
+// instance attributes). The buffer is split into GLW_RING_FRAMES partitions: each frame
+// sub-allocates from its own partition, and a fence keeps a partition from being reused
+// while the GPU may still read it. With buffer storage (desktop 4.4, ARB/EXT_buffer_storage,
+// loaded by glw_load_extensions) the whole buffer is mapped once, persistently and
+// coherently, and allocations write straight into it. Elsewhere (plain GLES3, WebGL, or
+// glw_load_extensions not called) allocations go to a CPU staging copy
+// that glw_ring_buffer_flush uploads into freshly orphaned storage.
+// Index data must not come from the ring: WebGL buffers cannot serve as both element and
+// non-element buffers.
+//
+//   glw_ring_buffer_begin_frame(&ring);
+//   glw_ring_buffer_alloc(&ring, sizeof(block), &range);  // fill range.data
+//   glw_ring_buffer_flush(&ring);                         // after the last alloc, before drawing
+//   glw_ring_buffer_bind_range(&ring, binding, &range);
+//   ... draws ...
+//   glw_ring_buffer_end_frame(&ring);
+#define GLW_RING_FRAMES 3
+
+typedef struct {
+    GLuint buffer;
+    GLsizeiptr frame_size;      // bytes available per frame
+    GLsizeiptr head;            // bytes used in the current partition
+    GLint alignment;            // every allocation starts on this boundary
+    int frame;                  // current partition
+    bool persistent;
+    uint8_t* data;              // persistent mapping of all partitions, or the staging copy
+    GLsync fences[GLW_RING_FRAMES];
+    uint64_t fence_waits;       // frames that had to wait for the GPU to release a partition
+} GLWRingBuffer;
+
+typedef struct {
+    void* data;                 // write-only; valid until the next begin_frame
+    GLintptr offset;            // into ring->buffer, for glBindBufferRange or attribute pointers
+    GLsizeiptr size;
+} GLWRingRange;
+
+GLWrapperError glw_ring_buffer_create(GLsizeiptr frame_size, GLWRingBuffer* out_ring);
+void glw_ring_buffer_delete(GLWRingBuffer* ring);
+void glw_ring_buffer_begin_frame(GLWRingBuffer* ring);
+GLWrapperError glw_ring_buffer_alloc(GLWRingBuffer* ring, GLsizeiptr size, GLWRingRange* out_range);
+void glw_ring_buffer_flush(GLWRingBuffer* ring);
+void glw_ring_buffer_bind_range(GLWRingBuffer* ring, GLuint binding, const GLWRingRange* range);
+void glw_ring_buffer_end_frame(GLWRingBuffer* ring);
+
+// Geometry pool
+// Meshes that share a vertex layout live in one vertex buffer and one index buffer behind a
+// single VAO. Each mesh owns a range of vertices and a range of indices handed out by
+// first-fit free lists; freed ranges merge with their neighbours. Indices stay relative to
+// the mesh's first vertex and are drawn with base vertex (GLES 3.2, desktop 3.2,
+// EXT/OES_draw_elements_base_vertex, loaded by glw_load_extensions), so switching between
+// pooled meshes binds nothing. Without base vertex (GLES 3.0, WebGL 2, or glw_load_extensions
+// not called before creating the pool) indices are rebased when uploaded instead; the
+// fixed restart index 0xFFFFFFFF is left alone. Capacity is fixed at creation.
+// The layout must be a single per-vertex stream.
+typedef struct {
+    GLuint offset;
+    GLuint count;
+} GLWPoolRange;
+
+typedef struct {
+    GLWPoolRange* ranges;       // free ranges, sorted by offset, never adjacent
+    int count;
+    int capacity;
+} GLWFreeList;
+
+typedef struct {
+    GLuint vao;
+    GLuint vbo;
+    GLuint ebo;                 // 0 if created without index capacity
+    GLsizei stride;
+    GLuint vertex_capacity;
+    GLuint index_capacity;
+    GLWFreeList free_vertices;
+    GLWFreeList free_indices;
+    bool base_vertex;           // false: stored indices are absolute vertex numbers
+} GLWGeometryPool;
+
+typedef struct {
+    GLint base_vertex;          // first vertex in the pool's vertex buffer
+    GLsizei vertex_count;
+    GLuint first_index;         // first index in the pool's index buffer
+    GLsizei index_count;        // 0 draws vertex_count vertices without indices
+} GLWPoolMesh;
+
+GLWrapperError glw_geometry_pool_create(const GLWVertexLayout* layout, int vertex_capacity, int index_capacity,
+                                        GLWGeometryPool* out_pool);
+void glw_geometry_pool_delete(GLWGeometryPool* pool);
+// vertices holds vertex_count vertices of the layout's stride; indices may be NULL
+GLWrapperError glw_geometry_pool_alloc(GLWGeometryPool* pool, const void* vertices, int vertex_count,
+                                       const unsigned int* indices, int index_count, GLWPoolMesh* out_mesh);
+void glw_geometry_pool_free(GLWGeometryPool* pool, GLWPoolMesh* mesh);
+// The pool's VAO stays bound afterwards, like glw_draw_mesh
+void glw_geometry_pool_draw(const GLWGeometryPool* pool, const GLWPoolMesh* mesh, GLenum draw_mode);
+
+// Draw lists
+// Collects draws of meshes from one geometry pool and submits them together. Each draw gets
+// a draw id, its position in the list, which shaders read from a uint vertex attribute at
+// draw_id_location to index per-draw data (transforms, materials) in uniform blocks or
+// textures. Where multi-draw indirect and base instance exist (desktop 4.3, GLES with
+// EXT_multi_draw_indirect and EXT_base_instance, loaded by glw_load_extensions) the whole
+// list is one glMultiDrawElementsIndirect: the id is fetched from an identity buffer at the
+// command's base instance. Elsewhere (GLES 3.0, WebGL 2) the list is drawn in a loop that sets the id
+// as a constant attribute before each draw. Only indexed pool meshes can be added.
+//
+//   layout(location = 7) in uint drawID;  // with draw_id_location 7
+typedef struct {
+    GLuint count;
+    GLuint instance_count;
+    GLuint first_index;
+    GLint base_vertex;
+    GLuint base_instance;
+} GLWDrawCommand;               // the layout glMultiDrawElementsIndirect reads
+
+typedef struct {
+    const GLWGeometryPool* pool;
+    GLWDrawCommand* commands;
+    int count;
+    int capacity;
+    GLuint draw_id_location;
+    GLuint draw_id_buffer;      // 0..capacity-1, read once per instance
+    GLuint indirect_buffer;
+    bool multi_draw;
+} GLWDrawList;
+
+// Adds the draw id attribute to the pool's VAO; delete the list before its pool
+GLWrapperError glw_draw_list_create(const GLWGeometryPool* pool, GLuint draw_id_location, int capacity,
+                                    GLWDrawList* out_list);
+void glw_draw_list_delete(GLWDrawList* list);
+void glw_draw_list_reset(GLWDrawList* list);
+// Returns the draw id, or -1 if the list is full or the mesh has no indices
+int glw_draw_list_add(GLWDrawList* list, const GLWPoolMesh* mesh);
+void glw_draw_list_submit(GLWDrawList* list, GLenum draw_mode);
+
 // Texture management
 typedef struct {
     GLuint id;
@@ -100,9 +411,49 @@ void glw_camera_process_mouse(GLWCamera* camera, float xoffset, float yoffset);
 
 // Utility functions
 const char* glw_error_string(GLWrapperError error);
-void glw_check_error(const char* operation);
 GLWrapperError glw_read_file(const char* filename, char** out_content);
 
+// Read-only file view: mmap'd on POSIX, a single buffered read on emscripten/Windows.
+// data is not NUL-terminated; always use length.
+typedef struct {
+    const char* data;
+    size_t length;
+    bool mapped;
+} GLWFileView;
+
+GLWrapperError glw_file_view_open(const char* filename, GLWFileView* out_view);
+void glw_file_view_close(GLWFileView* view);
+
+// GL error checking. glGetError stalls the pipeline on many drivers, so how often it runs
+// is chosen at compile time with GLW_ERROR_CHECK_LEVEL:
+//   0: no glGetError calls at all (default unless GL_WRAPPER_DEBUG)
+//   1: glw_frame_check_errors() drains the error queue once per frame
+//   2: additionally glw_check_error() after every wrapper call (default with GL_WRAPPER_DEBUG)
+// Checks below the selected level compile to nothing. glw_enable_debug_output() installs
+// a KHR_debug callback where available (GLES 3.2 / desktop 4.3 / GL_KHR_debug, after
+// glw_load_extensions; never on WebGL) so errors are reported by the driver without polling.
+#ifndef GLW_ERROR_CHECK_LEVEL
+#ifdef GL_WRAPPER_DEBUG
+#define GLW_ERROR_CHECK_LEVEL 2
+#else
+#define GLW_ERROR_CHECK_LEVEL 0
+#endif
+#endif
+
+#if GLW_ERROR_CHECK_LEVEL >= 2
+void glw_check_error(const char* operation);
+#else
+#define glw_check_error(operation) ((void)0)
+#endif
+
+#if GLW_ERROR_CHECK_LEVEL >= 1
+bool glw_frame_check_errors(const char* label);
+#else
+static inline bool glw_frame_check_errors(const char* label) { (void)label; return false; }
+#endif
+
+bool glw_enable_debug_output(void);
+
 // Debug functions (can be disabled in release builds)
 #ifdef GL_WRAPPER_DEBUG
 void glw_log(const char* format, ...);
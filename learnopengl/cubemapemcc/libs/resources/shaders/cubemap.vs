@@ -5,9 +5,13 @@ layout (location = 1) in vec2 aTexCoords;
 
 out vec2 TexCoords;
 
+// Streamed once per frame from the ring buffer, shared with skybox.vs
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+};
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main()
 {
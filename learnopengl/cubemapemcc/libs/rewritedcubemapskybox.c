@@ -15,17 +15,33 @@
 #define SCREEN_HEIGHT 600
 #define MAX_SHADER_SIZE 10000
 #define MAX_FACES 6
+#define CAMERA_BLOCK_BINDING 0
+#define FRAME_RING_SIZE 4096
+#define SCENE_POOL_VERTICES 4096   // capacity shared by every position + texcoord mesh
+#define SCENE_POOL_INDICES 8192
+
+// Matches the std140 Camera block in cubemap.vs and skybox.vs
+typedef struct {
+    mat4 view;
+    mat4 projection;
+} CameraBlock;
 
 // Function prototypes
 void main_loop(void);
 GLWTexture LoadTextureGL(const char *path);
 GLWTexture LoadCubemapGL(const char* faces[]);
-void check_gl_error(const char* operation);
+
+// Per-operation checks only exist at GLW_ERROR_CHECK_LEVEL 2; see gl_wrapper.h
+#define check_gl_error(operation) glw_check_error(operation)
 
 // Global variables
 GLWShader shader, skyboxShader;
-GLWMesh cubeMesh, skyboxMesh;
+GLWUniformName modelUniform, texture1Uniform;
+GLWGeometryPool scenePool;
+GLWPoolMesh cubeMesh;
+GLWMesh skyboxMesh;
 GLWTexture cubeTexture, cubemapTexture;
+GLWRingBuffer frameRing;
 Camera3D camera = { 0 };
 bool show_container = true;
 float camera_z_offset = 0.0f;
@@ -43,57 +59,23 @@ int main() {
     glEnable(GL_DEPTH_TEST);
     check_gl_error("Enable depth test");
 
-    char* vertex_source = NULL;
-    char* fragment_source = NULL;
     GLWrapperError error;
 
     // Create cubemaps shader
-    error = glw_read_file("resources/shaders/cubemap.vs", &vertex_source);
-    if (error != GL_WRAPPER_SUCCESS) {
-        printf("Failed to read cubemaps vertex shader: %s\n", glw_error_string(error));
-        return -1;
-    }
-
-    error = glw_read_file("resources/shaders/cubemap.fs", &fragment_source);
-    if (error != GL_WRAPPER_SUCCESS) {
-        printf("Failed to read cubemaps fragment shader: %s\n", glw_error_string(error));
-        free(vertex_source);
-        return -1;
-    }
-
-    error = glw_create_shader(vertex_source, fragment_source, &shader);
+    error = glw_create_shader_from_files("resources/shaders/cubemap.vs", "resources/shaders/cubemap.fs", &shader);
     if (error != GL_WRAPPER_SUCCESS) {
         printf("Failed to create cubemaps shader: %s\n", glw_error_string(error));
-        free(vertex_source);
-        free(fragment_source);
         return -1;
     }
-    free(vertex_source);
-    free(fragment_source);
+    modelUniform = glw_uniform_name("model");
+    texture1Uniform = glw_uniform_name("texture1");
 
     // Create skybox shader
-    error = glw_read_file("resources/shaders/skybox.vs", &vertex_source);
-    if (error != GL_WRAPPER_SUCCESS) {
-        printf("Failed to read skybox vertex shader: %s\n", glw_error_string(error));
-        return -1;
-    }
-
-    error = glw_read_file("resources/shaders/skybox.fs", &fragment_source);
-    if (error != GL_WRAPPER_SUCCESS) {
-        printf("Failed to read skybox fragment shader: %s\n", glw_error_string(error));
-        free(vertex_source);
-        return -1;
-    }
-
-    error = glw_create_shader(vertex_source, fragment_source, &skyboxShader);
+    error = glw_create_shader_from_files("resources/shaders/skybox.vs", "resources/shaders/skybox.fs", &skyboxShader);
     if (error != GL_WRAPPER_SUCCESS) {
         printf("Failed to create skybox shader: %s\n", glw_error_string(error));
-        free(vertex_source);
-        free(fragment_source);
         return -1;
     }
-    free(vertex_source);
-    free(fragment_source);
 
     // Set up vertex data
 
@@ -187,13 +169,44 @@ int main() {
     };
 
     // Create mesh objects
-    error = glw_create_mesh(cubeVertices, sizeof(cubeVertices) / sizeof(float) / 5, NULL, 0, 5 * sizeof(float), &cubeMesh);
+    // Position + texcoord meshes are sub-allocated from one pool and share its VAO
+    GLWVertexLayout sceneLayout = {
+        .attribs = {
+            { .location = 0, .components = 3, .type = GL_FLOAT, .offset = 0 },
+            { .location = 1, .components = 2, .type = GL_FLOAT, .offset = 3 * sizeof(float) },
+        },
+        .attrib_count = 2,
+        .strides = { 5 * sizeof(float) },
+        .stream_count = 1,
+    };
+    error = glw_geometry_pool_create(&sceneLayout, SCENE_POOL_VERTICES, SCENE_POOL_INDICES, &scenePool);
+    if (error != GL_WRAPPER_SUCCESS) {
+        printf("Failed to create geometry pool: %s\n", glw_error_string(error));
+        return -1;
+    }
+    error = glw_geometry_pool_alloc(&scenePool, cubeVertices, sizeof(cubeVertices) / sizeof(float) / 5, NULL, 0, &cubeMesh);
     if (error != GL_WRAPPER_SUCCESS) {
         printf("Failed to create cube mesh: %s\n", glw_error_string(error));
         return -1;
     }
 
-    error = glw_create_mesh(skyboxVertices, sizeof(skyboxVertices) / sizeof(float) / 3, NULL, 0, 3 * sizeof(float), &skyboxMesh);
+    // Skybox corners are all +-1, so signed bytes hold them exactly: 4 bytes per vertex
+    // (padded for alignment) instead of 12. GL_BYTE without normalization reads as -1.0/1.0.
+    enum { SKYBOX_VERTEX_COUNT = sizeof(skyboxVertices) / sizeof(float) / 3 };
+    int8_t skyboxPacked[SKYBOX_VERTEX_COUNT * 4] = {0};
+    for (int i = 0; i < SKYBOX_VERTEX_COUNT; i++) {
+        for (int c = 0; c < 3; c++) {
+            skyboxPacked[i * 4 + c] = (int8_t)skyboxVertices[i * 3 + c];
+        }
+    }
+    GLWVertexLayout skyboxLayout = {
+        .attribs = { { .location = 0, .components = 3, .type = GL_BYTE, .offset = 0, .stream = 0 } },
+        .attrib_count = 1,
+        .strides = { 4 },
+        .stream_count = 1,
+    };
+    const void* skyboxStreams[] = { skyboxPacked };
+    error = glw_create_mesh_layout(&skyboxLayout, skyboxStreams, SKYBOX_VERTEX_COUNT, 0, NULL, 0, &skyboxMesh);
     if (error != GL_WRAPPER_SUCCESS) {
         printf("Failed to create skybox mesh: %s\n", glw_error_string(error));
         return -1;
@@ -248,6 +261,16 @@ int main() {
     }
     check_gl_error("Set skybox shader uniform");
 
+    // Both programs read the camera from the same per-frame range of the ring buffer
+    glUniformBlockBinding(shader.program, glGetUniformBlockIndex(shader.program, "Camera"), CAMERA_BLOCK_BINDING);
+    glUniformBlockBinding(skyboxShader.program, glGetUniformBlockIndex(skyboxShader.program, "Camera"), CAMERA_BLOCK_BINDING);
+    error = glw_ring_buffer_create(FRAME_RING_SIZE, &frameRing);
+    if (error != GL_WRAPPER_SUCCESS) {
+        printf("Failed to create frame ring buffer: %s\n", glw_error_string(error));
+        return -1;
+    }
+    printf("Frame ring buffer: %s\n", frameRing.persistent ? "persistently mapped" : "orphaned");
+
     // Initialize camera
     camera.position = (Vector3){ 0.0f, 0.0f, 3.0f };
     camera.target = (Vector3){ 0.0f, 0.0f, 0.0f };
@@ -290,6 +313,8 @@ void main_loop(void) {
 
     // Draw
     BeginDrawing();
+    // rlgl may have changed bindings since the last frame
+    glw_invalidate_state();
 
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -316,71 +341,64 @@ void main_loop(void) {
         printf("%f %f %f %f\n", projection[i][0], projection[i][1], projection[i][2], projection[i][3]);
     }
 
+    // Stream the camera block; the skybox shader drops the translation itself
+    glw_ring_buffer_begin_frame(&frameRing);
+    GLWRingRange cameraRange;
+    if (glw_ring_buffer_alloc(&frameRing, sizeof(CameraBlock), &cameraRange) == GL_WRAPPER_SUCCESS) {
+        CameraBlock* block = cameraRange.data;
+        glm_mat4_copy(view, block->view);
+        glm_mat4_copy(projection, block->projection);
+        glw_ring_buffer_flush(&frameRing);
+        glw_ring_buffer_bind_range(&frameRing, CAMERA_BLOCK_BINDING, &cameraRange);
+    }
+    check_gl_error("Update camera block");
+
     // Draw cube
     if (show_container) {
         glw_use_shader(&shader);
         check_gl_error("Use cube shader");
 
         mat4 model = GLM_MAT4_IDENTITY_INIT;
-        glw_set_uniform_mat4(&shader, "model", model);
-        glw_set_uniform_mat4(&shader, "view", view);
-        glw_set_uniform_mat4(&shader, "projection", projection);
+        glw_set_uniform_mat4_hashed(&shader, modelUniform, model);
         check_gl_error("Set cube shader uniforms");
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, cubeTexture.id);
-        glw_set_uniform_1i(&shader, "texture1", 0);
+        glw_bind_texture_unit(0, GL_TEXTURE_2D, cubeTexture.id);
+        glw_set_uniform_1i_hashed(&shader, texture1Uniform, 0);
         check_gl_error("Bind cube texture");
 
-        glBindVertexArray(cubeMesh.vao);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
+        glw_geometry_pool_draw(&scenePool, &cubeMesh, GL_TRIANGLES);
         check_gl_error("Draw cube");
     }
 
     // Draw skybox last
-    glDepthFunc(GL_LEQUAL);
-    glUseProgram(skyboxShader.program);
+    glw_set_depth_func(GL_LEQUAL);
+    glw_use_shader(&skyboxShader);
     check_gl_error("Use skybox shader");
 
-    mat4 skyboxView;
-    glm_mat4_copy(view, skyboxView);
-    skyboxView[3][0] = skyboxView[3][1] = skyboxView[3][2] = 0.0f; // Remove translation
-
-    GLint viewLoc = glGetUniformLocation(skyboxShader.program, "view");
-    GLint projLoc = glGetUniformLocation(skyboxShader.program, "projection");
-
-    if (viewLoc != -1) {
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, (float*)skyboxView);
-    } else {
-        printf("Warning: 'view' uniform not found in skybox shader\n");
-    }
-
-    if (projLoc != -1) {
-        glUniformMatrix4fv(projLoc, 1, GL_FALSE, (float*)projection);
-    } else {
-        printf("Warning: 'projection' uniform not found in skybox shader\n");
-    }
-
-    check_gl_error("Set skybox shader uniforms");
-
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture.id);
+    glw_bind_texture_unit(0, GL_TEXTURE_CUBE_MAP, cubemapTexture.id);
     check_gl_error("Bind cubemap texture");
 
     printf("Drawing skybox with VAO: %u\n", skyboxMesh.vao);
-    glBindVertexArray(skyboxMesh.vao);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
+    glw_draw_mesh(&skyboxMesh, GL_TRIANGLES);
     check_gl_error("Draw skybox");
 
-    glDepthFunc(GL_LESS);
+    glw_set_depth_func(GL_LESS);
 
     // Print debug information
     printf("Camera position: (%f, %f, %f)\n", camera.position.x, camera.position.y, camera.position.z);
     printf("Camera target: (%f, %f, %f)\n", camera.target.x, camera.target.y, camera.target.z);
     printf("Skybox texture ID: %u\n", cubemapTexture.id);
 
+    GLWUniformStats uniformStats;
+    glw_get_uniform_stats(&uniformStats);
+    printf("Uniform uploads: %llu issued, %llu skipped\n",
+           (unsigned long long)uniformStats.issued, (unsigned long long)uniformStats.skipped);
+
+    GLWStateStats stateStats;
+    glw_get_state_stats(&stateStats);
+    printf("State changes: %llu issued, %llu elided\n",
+           (unsigned long long)stateStats.issued, (unsigned long long)stateStats.elided);
+
     GLint currentProgram;
     glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
     printf("Current shader program: %d\n", currentProgram);
@@ -395,6 +413,10 @@ void main_loop(void) {
     glGetBooleanv(GL_DEPTH_TEST, &depthTest);
     printf("Depth test enabled: %s\n", depthTest ? "true" : "false");
 
+    // Leave no VAO of ours bound for rlgl's batch
+    glw_bind_vertex_array(0);
+    glw_ring_buffer_end_frame(&frameRing);
+    glw_frame_check_errors("frame");
     EndDrawing();
 
 }
@@ -479,11 +501,3 @@ GLWTexture LoadCubemapGL(const char* faces[]) {
     printf("Cubemap created with ID: %u\n", cubemap.id);
     return cubemap;
 }
-
-
-void check_gl_error(const char* operation) {
-    GLenum error;
-    while ((error = glGetError()) != GL_NO_ERROR) {
-        printf("OpenGL error after %s: 0x%x\n", operation, error);
-    }
-}
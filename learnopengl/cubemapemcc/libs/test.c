@@ -52,7 +52,7 @@ void setup(void) {
     };
 
     // Create mesh
-    error = glw_create_mesh(vertices, 3, NULL, 0, 3, &triangle_mesh);
+    error = glw_create_mesh(vertices, 3, NULL, 0, 3 * sizeof(float), &triangle_mesh);
     if (error != GL_WRAPPER_SUCCESS) {
         TraceLog(LOG_ERROR, "Failed to create mesh: %s", glw_error_string(error));
         return;
@@ -4,12 +4,18 @@ layout (location = 1) in vec2 aTexCoords;
 
 out vec2 TexCoords;
 
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 view_projection;
+    vec4 camera_pos;
+    float time;
+};
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main()
 {
     TexCoords = aTexCoords;    
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-}
\ No newline at end of file
+    gl_Position = view_projection * model * vec4(aPos, 1.0);
+}
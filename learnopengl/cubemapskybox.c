@@ -3,13 +3,14 @@
 #include <cglm/cglm.h>
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#define USE_OPENGL   // Utils.c must be built with -DUSE_OPENGL as well
+#include "Utils.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
 
-#define MAX_SHADER_SIZE 10000
 #define MAX_FACES 6
 
 // Function prototypes
@@ -75,146 +76,29 @@ float lastFrame = 0.0f;
 // Shader struct and functions
 typedef struct {
     unsigned int ID;
+    UtilsUniformTable uniforms;   // reflected once after linking
 } Shader;
 
-void shader_init(Shader* shader, const char* vertexPath, const char* fragmentPath) {
-    printf("Initializing shader: %s and %s\n", vertexPath, fragmentPath);
-
-    // 1. retrieve the vertex/fragment source code from filePath
-    FILE* vShaderFile;
-    FILE* fShaderFile;
-    char vertexCode[MAX_SHADER_SIZE] = {0};
-    char fragmentCode[MAX_SHADER_SIZE] = {0};
-
-    // open files
-    vShaderFile = fopen(vertexPath, "rb");
-    if (!vShaderFile) {
-        fprintf(stderr, "Failed to open vertex shader file: %s\n", vertexPath);
-        return;
-    }
-
-    fShaderFile = fopen(fragmentPath, "rb");
-    if (!fShaderFile) {
-        fprintf(stderr, "Failed to open fragment shader file: %s\n", fragmentPath);
-        fclose(vShaderFile);
-        return;
-    }
-
-    printf("Shader files opened successfully\n");
-
-    // read file's buffer contents into strings
-    size_t vertexBytesRead = fread(vertexCode, 1, MAX_SHADER_SIZE - 1, vShaderFile);
-    size_t fragmentBytesRead = fread(fragmentCode, 1, MAX_SHADER_SIZE - 1, fShaderFile);
-
-    printf("Vertex shader bytes read: %zu\n", vertexBytesRead);
-    printf("Fragment shader bytes read: %zu\n", fragmentBytesRead);
-
-    // close file handlers
-    fclose(vShaderFile);
-    fclose(fShaderFile);
-
-    // Null-terminate the strings
-    vertexCode[vertexBytesRead] = '\0';
-    fragmentCode[fragmentBytesRead] = '\0';
-
-    printf("Compiling vertex shader...\n");
-
-    // 2. compile shaders
-    unsigned int vertex, fragment;
-    int success;
-    char infoLog[512];
-
-    // vertex Shader
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    if (vertex == 0) {
-        fprintf(stderr, "Failed to create vertex shader\n");
-        return;
-    }
-
-    const char* vShaderCode = vertexCode;
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
-
-    // print compile errors if any
-    glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-        fprintf(stderr, "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n%s\n", infoLog);
-        glDeleteShader(vertex);
-        return;
-    }
-    printf("Vertex shader compiled successfully\n");
-
-    printf("Compiling fragment shader...\n");
-
-    // fragment Shader
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    if (fragment == 0) {
-        fprintf(stderr, "Failed to create fragment shader\n");
-        glDeleteShader(vertex);
-        return;
-    }
-
-    const char* fShaderCode = fragmentCode;
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
-
-    // print compile errors if any
-    glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-        fprintf(stderr, "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n%s\n", infoLog);
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        return;
-    }
-    printf("Fragment shader compiled successfully\n");
-
-    printf("Linking shader program...\n");
-
-    // shader Program
-    shader->ID = glCreateProgram();
-    if (shader->ID == 0) {
-        fprintf(stderr, "Failed to create shader program\n");
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        return;
-    }
-
-    glAttachShader(shader->ID, vertex);
-    glAttachShader(shader->ID, fragment);
-    glLinkProgram(shader->ID);
-
-    // print linking errors if any
-    glGetProgramiv(shader->ID, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shader->ID, 512, NULL, infoLog);
-        fprintf(stderr, "ERROR::SHADER::PROGRAM::LINKING_FAILED\n%s\n", infoLog);
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        glDeleteProgram(shader->ID);
-        shader->ID = 0;
-        return;
-    }
-    printf("Shader program linked successfully\n");
-
-    // delete the shaders as they're linked into our program now and no longer necessary
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+void shader_load(Shader* shader, unsigned int program) {
+    shader->ID = program;
+    utils_uniform_table_init(&shader->uniforms, program);
+}
 
-    printf("Shader initialization complete\n");
+// Resolve a location once at setup; the setters below take it directly
+int shader_location(const Shader* shader, const char* name) {
+    return utils_uniform_location(&shader->uniforms, name);
 }
 
 void shader_use(Shader* shader) {
     glUseProgram(shader->ID);
 }
 
-void shader_set_int(Shader* shader, const char* name, int value) {
-    glUniform1i(glGetUniformLocation(shader->ID, name), value);
+void shader_set_int(int location, int value) {
+    utils_uniform_set_int(location, value);
 }
 
-void shader_set_mat4(Shader* shader, const char* name, mat4 mat) {
-    glUniformMatrix4fv(glGetUniformLocation(shader->ID, name), 1, GL_FALSE, (float*)mat);
+void shader_set_mat4(int location, mat4 mat) {
+    utils_uniform_set_mat4(location, (float*)mat);
 }
 
 // Error checking function
@@ -236,7 +120,32 @@ void check_gl_error(const char *file, int line) {
     }
 }
 
+// glGetError stalls the pipeline on many drivers, so checks are chosen at compile time:
+//   0: none (default with NDEBUG)
+//   1: once per frame, skipped when the driver reports through KHR_debug (default)
+//   2: additionally after every CHECK_GL_ERROR()
+#ifndef GL_ERROR_CHECK_LEVEL
+#ifdef NDEBUG
+#define GL_ERROR_CHECK_LEVEL 0
+#else
+#define GL_ERROR_CHECK_LEVEL 1
+#endif
+#endif
+
+#if GL_ERROR_CHECK_LEVEL >= 2
 #define CHECK_GL_ERROR() check_gl_error(__FILE__, __LINE__)
+#else
+#define CHECK_GL_ERROR() ((void)0)
+#endif
+
+#if GL_ERROR_CHECK_LEVEL >= 1
+#define CHECK_GL_FRAME_ERRORS() do { if (!gl_debug_output) check_gl_error(__FILE__, __LINE__); } while (0)
+#else
+#define CHECK_GL_FRAME_ERRORS() ((void)0)
+#endif
+
+// set when utils_enable_debug_output() installed the KHR_debug callback
+bool gl_debug_output = false;
 
 int main()
 {
@@ -252,6 +161,9 @@ int main()
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#if GL_ERROR_CHECK_LEVEL > 0
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
+#endif
 
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
@@ -283,26 +195,30 @@ int main()
     }
     printf("GLEW initialized\n");
 
+#if GL_ERROR_CHECK_LEVEL > 0
+    gl_debug_output = utils_enable_debug_output();
+    if (gl_debug_output) {
+        printf("GL debug output enabled\n");
+    }
+#endif
+
     // configure global opengl state
     glEnable(GL_DEPTH_TEST);
     CHECK_GL_ERROR();
 
-    // build and compile shaders
-    Shader shader, skyboxShader;
+    // submit both shader programs; the driver compiles them while we set up
+    // buffers and textures, and the render loop picks them up once they finish
+    Shader shader = {0}, skyboxShader = {0};
+    int modelLoc = -1;
+
+    // view/projection live in the shared FrameData block, written once per frame
+    UtilsFrameData frameData;
+    unsigned int frameDataBuffer = utils_frame_data_create();
+    UtilsShaderBatch shaderBatch;
     printf("Compiling shaders...\n");
-    shader_init(&shader, "cubemaps.vs", "cubemaps.fs");
-    if (shader.ID == 0) {
-        fprintf(stderr, "Failed to initialize cubemaps shader\n");
-        glfwTerminate();
-        return -1;
-    }
-    shader_init(&skyboxShader, "skybox.vs", "skybox.fs");
-    if (skyboxShader.ID == 0) {
-        fprintf(stderr, "Failed to initialize skybox shader\n");
-        glfwTerminate();
-        return -1;
-    }
-    printf("Shaders compiled successfully\n");
+    utils_shader_batch_init(&shaderBatch);
+    int cubeProgram = utils_shader_batch_add(&shaderBatch, "cubemaps.vs", "cubemaps.fs");
+    int skyboxProgram = utils_shader_batch_add(&shaderBatch, "skybox.vs", "skybox.fs");
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
@@ -395,31 +311,64 @@ int main()
         1.0f, -1.0f,  1.0f
     };
 
+    // weld the triangle soups into indexed meshes ordered for the vertex cache
+    UtilsMesh cubeMesh, skyboxMesh;
+    if (!utils_mesh_optimize(cubeVertices, 36, 5, NULL, 0, &cubeMesh) ||
+        !utils_mesh_optimize(skyboxVertices, 36, 3, NULL, 0, &skyboxMesh)) {
+        printf("Failed to optimize meshes\n");
+        return -1;
+    }
+    printf("Cube: %zu vertices, ACMR %.2f -> %.2f; skybox: %zu vertices, ACMR %.2f -> %.2f\n",
+           cubeMesh.vertex_count, cubeMesh.before.acmr, cubeMesh.after.acmr,
+           skyboxMesh.vertex_count, skyboxMesh.before.acmr, skyboxMesh.after.acmr);
+
+    // pack the cube into unorm16 positions and half float texcoords (12 bytes instead of 20);
+    // the dequantize matrix is folded into the model matrix when drawing
+    UtilsQuantizedLayout cubeLayout;
+    unsigned char* cubePacked = utils_mesh_quantize(cubeMesh.vertices, cubeMesh.vertex_count, 5, 3, -1, &cubeLayout);
+    if (!cubePacked) {
+        printf("Failed to quantize cube\n");
+        return -1;
+    }
+    mat4 cubeDequantize;
+    memcpy(cubeDequantize, cubeLayout.dequantize, sizeof(cubeDequantize));
+
     // cube VAO
-    unsigned int cubeVAO, cubeVBO;
+    unsigned int cubeVAO, cubeVBO, cubeEBO;
     glGenVertexArrays(1, &cubeVAO);
     glGenBuffers(1, &cubeVBO);
+    glGenBuffers(1, &cubeEBO);
     glBindVertexArray(cubeVAO);
     glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, cubeMesh.vertex_count * cubeLayout.stride, cubePacked, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cubeEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, cubeMesh.index_count * sizeof(unsigned int), cubeMesh.indices, GL_STATIC_DRAW);
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+    glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, (GLsizei)cubeLayout.stride, (void*)0);
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+    glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, (GLsizei)cubeLayout.stride, (void*)cubeLayout.texcoord_offset);
     CHECK_GL_ERROR();
     printf("Cube VAO set up\n");
 
     // skybox VAO
-    unsigned int skyboxVAO, skyboxVBO;
+    unsigned int skyboxVAO, skyboxVBO, skyboxEBO;
     glGenVertexArrays(1, &skyboxVAO);
     glGenBuffers(1, &skyboxVBO);
+    glGenBuffers(1, &skyboxEBO);
     glBindVertexArray(skyboxVAO);
     glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), skyboxVertices, GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, skyboxMesh.vertex_count * 3 * sizeof(float), skyboxMesh.vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, skyboxEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, skyboxMesh.index_count * sizeof(unsigned int), skyboxMesh.indices, GL_STATIC_DRAW);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     CHECK_GL_ERROR();
     printf("Skybox VAO set up\n");
+    GLsizei cubeIndexCount = (GLsizei)cubeMesh.index_count;
+    GLsizei skyboxIndexCount = (GLsizei)skyboxMesh.index_count;
+    utils_mesh_free(&cubeMesh);
+    utils_mesh_free(&skyboxMesh);
+    free(cubePacked);
 
     // load textures
     printf("Loading cube texture...\n");
@@ -446,15 +395,6 @@ int main()
     }
     printf("Cubemap textures loaded\n");
 
-    // shader configuration
-    shader_use(&shader);
-    shader_set_int(&shader, "texture1", 0);
-    CHECK_GL_ERROR();
-
-    shader_use(&skyboxShader);
-    shader_set_int(&skyboxShader, "skybox", 0);
-    CHECK_GL_ERROR();
-
     // initialize camera
     camera_init(&camera);
     printf("Camera initialized\n");
@@ -472,12 +412,40 @@ int main()
         // input
         processInput(window);
 
+        // pick up shader programs as they finish compiling; cached or failed programs are
+        // already settled at submit, so check statuses rather than the pending count
+        if (shader.ID == 0 || skyboxShader.ID == 0) {
+            utils_shader_batch_poll(&shaderBatch);
+            if (utils_shader_batch_status(&shaderBatch, cubeProgram) == UTILS_PROGRAM_FAILED ||
+                utils_shader_batch_status(&shaderBatch, skyboxProgram) == UTILS_PROGRAM_FAILED) {
+                fprintf(stderr, "Failed to initialize shaders\n");
+                glfwTerminate();
+                return -1;
+            }
+            if (shader.ID == 0 && utils_shader_batch_status(&shaderBatch, cubeProgram) == UTILS_PROGRAM_READY) {
+                shader_load(&shader, utils_shader_batch_program(&shaderBatch, cubeProgram));
+                modelLoc = shader_location(&shader, "model");
+                utils_frame_data_bind_program(shader.ID);
+                shader_use(&shader);
+                shader_set_int(shader_location(&shader, "texture1"), 0);
+                CHECK_GL_ERROR();
+                printf("Cubemaps shader ready\n");
+            }
+            if (skyboxShader.ID == 0 && utils_shader_batch_status(&shaderBatch, skyboxProgram) == UTILS_PROGRAM_READY) {
+                shader_load(&skyboxShader, utils_shader_batch_program(&shaderBatch, skyboxProgram));
+                utils_frame_data_bind_program(skyboxShader.ID);
+                shader_use(&skyboxShader);
+                shader_set_int(shader_location(&skyboxShader, "skybox"), 0);
+                CHECK_GL_ERROR();
+                printf("Skybox shader ready\n");
+            }
+        }
+
         // render
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // draw scene as normal
-        shader_use(&shader);
         mat4 model = GLM_MAT4_IDENTITY_INIT;
         mat4 view;
         camera_get_view_matrix(&camera, view);
@@ -488,9 +456,11 @@ int main()
 
         mat4 projection;
         glm_perspective(glm_rad(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f, projection);
-        shader_set_mat4(&shader, "model", model);
-        shader_set_mat4(&shader, "view", view);
-        shader_set_mat4(&shader, "projection", projection);
+
+        // the Z offset moves the world, so the eye sits at Position - offset
+        vec3 eye = {camera.Position[0], camera.Position[1], camera.Position[2] - camera_z_offset};
+        utils_frame_data_set(&frameData, (float*)view, (float*)projection, eye, currentFrame);
+        utils_frame_data_update(frameDataBuffer, &frameData);
 
         // Print debug information
         printf("  Camera Position: (%.2f, %.2f, %.2f)\n", camera.Position[0], camera.Position[1], camera.Position[2]);
@@ -500,11 +470,15 @@ int main()
 
 
         // cubes
-        if (show_container) {
+        if (show_container && shader.ID != 0) {
+            shader_use(&shader);
+            mat4 cubeModel;
+            glm_mat4_mul(model, cubeDequantize, cubeModel);
+            shader_set_mat4(modelLoc, cubeModel);
             glBindVertexArray(cubeVAO);
             glActiveTexture(GL_TEXTURE0);
             glBindTexture(GL_TEXTURE_2D, cubeTexture);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+            glDrawElements(GL_TRIANGLES, cubeIndexCount, GL_UNSIGNED_INT, 0);
             glBindVertexArray(0);
             printf("Cube rendered\n");
         } else {
@@ -513,30 +487,25 @@ int main()
 
         CHECK_GL_ERROR();
 
-        // draw skybox as last
-        glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
-        shader_use(&skyboxShader);
-        mat4 skyboxView;
-        mat3 rotView;
-        glm_mat4_copy(view, skyboxView);
-        glm_mat4_pick3(skyboxView, rotView);
-        glm_mat4_identity(skyboxView);
-        glm_mat4_ins3(rotView, skyboxView);
-        shader_set_mat4(&skyboxShader, "view", skyboxView);
-        shader_set_mat4(&skyboxShader, "projection", projection);
-
-        // skybox cube
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS); // set depth function back to default
+        // draw skybox as last, once its program is ready
+        if (skyboxShader.ID != 0) {
+            glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
+            shader_use(&skyboxShader);  // strips the view translation itself
 
-        CHECK_GL_ERROR();
-        printf("Skybox rendered\n");
+            // skybox cube
+            glBindVertexArray(skyboxVAO);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+            glDrawElements(GL_TRIANGLES, skyboxIndexCount, GL_UNSIGNED_INT, 0);
+            glBindVertexArray(0);
+            glDepthFunc(GL_LESS); // set depth function back to default
+
+            CHECK_GL_ERROR();
+            printf("Skybox rendered\n");
+        }
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+        CHECK_GL_FRAME_ERRORS();
         glfwSwapBuffers(window);
         glfwPollEvents();
 
@@ -549,6 +518,11 @@ int main()
     glDeleteVertexArrays(1, &skyboxVAO);
     glDeleteBuffers(1, &cubeVBO);
     glDeleteBuffers(1, &skyboxVBO);
+    glDeleteBuffers(1, &cubeEBO);
+    glDeleteBuffers(1, &skyboxEBO);
+    glDeleteBuffers(1, &frameDataBuffer);
+    utils_uniform_table_free(&shader.uniforms);
+    utils_uniform_table_free(&skyboxShader.uniforms);
     CHECK_GL_ERROR();
 
     glfwTerminate();
@@ -646,10 +620,13 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
         camera.Pitch = -89.0f;
 
     // update Front, Right and Up Vectors using the updated Euler angles
+    float sinYaw, cosYaw, sinPitch, cosPitch;
+    utils_sincosf(glm_rad(camera.Yaw), &sinYaw, &cosYaw);
+    utils_sincosf(glm_rad(camera.Pitch), &sinPitch, &cosPitch);
     vec3 front;
-    front[0] = cos(glm_rad(camera.Yaw)) * cos(glm_rad(camera.Pitch));
-    front[1] = sin(glm_rad(camera.Pitch));
-    front[2] = sin(glm_rad(camera.Yaw)) * cos(glm_rad(camera.Pitch));
+    front[0] = cosYaw * cosPitch;
+    front[1] = sinPitch;
+    front[2] = sinYaw * cosPitch;
     glm_vec3_normalize_to(front, camera.Front);
     // also re-calculate the Right and Up vector
     glm_vec3_cross(camera.Front, camera.WorldUp, camera.Right);
@@ -5,6 +5,9 @@
 #include <stdlib.h>
 #include <math.h>
 #include <stdbool.h>
+#include <string.h>
+#define USE_OPENGL   // Utils.c must be built with -DUSE_OPENGL as well
+#include "Utils.h"
 
 #define PI 3.14159265358979323846
 
@@ -17,8 +20,9 @@ const char* vertexShaderSource = "#version 330 core\n"
     "out vec3 TexCoords;\n"
     "void main()\n"
     "{\n"
-    "    TexCoords = aPos;\n"
-    "    gl_Position = projection * view * model * vec4(aPos, 1.0);\n"
+    "    vec4 worldPos = model * vec4(aPos, 1.0);\n"
+    "    TexCoords = worldPos.xyz;\n"
+    "    gl_Position = projection * view * worldPos;\n"
     "}\0";
 
 // Fragment shader
@@ -41,35 +45,90 @@ const char* fragmentShaderSource = "#version 330 core\n"
     "    }\n"
     "}\0";
 
+#define SPHERE_RESTART_INDEX 0xFFFFFFFFu   // what GL_PRIMITIVE_RESTART_FIXED_INDEX uses for GL_UNSIGNED_INT
+
+// Indexed sphere: every vertex is shared by the quads around it
+typedef struct {
+    float* vertices;        // (stacks + 1) * (slices + 1) positions
+    int vertexCount;
+    unsigned int* indices;
+    int indexCount;
+    int upperIndexCount;    // the first rows cover y >= 0; drawing only these gives the sky half
+    GLenum mode;            // GL_TRIANGLE_STRIP with restart indices, or GL_TRIANGLES
+} SphereMesh;
+
 // Function to create a sphere mesh
-void createSphereMesh(float radius, int stacks, int slices, float** vertices, int* vertexCount) {
-    *vertexCount = (stacks + 1) * (slices + 1) * 2;
-    *vertices = (float*)malloc(*vertexCount * 3 * sizeof(float));
-    
+// With primitiveRestart each stack is one strip terminated by SPHERE_RESTART_INDEX;
+// otherwise the same quads are emitted as a triangle list. stacks should be even so the
+// equator falls on a ring.
+void createSphereMesh(float radius, int stacks, int slices, bool primitiveRestart, SphereMesh* mesh) {
+    int ringSize = slices + 1;
+    mesh->vertexCount = (stacks + 1) * ringSize;
+    mesh->vertices = (float*)malloc(mesh->vertexCount * 3 * sizeof(float));
+
+    // Every ring reuses the same sin/cos values, so compute each angle once up front
+    int phiCount = stacks + 1;
+    int thetaCount = slices + 1;
+    float* angles = (float*)malloc((phiCount + thetaCount) * 3 * sizeof(float));
+    float* sinTable = angles + phiCount + thetaCount;
+    float* cosTable = sinTable + phiCount + thetaCount;
+    for (int i = 0; i < phiCount; ++i) {
+        angles[i] = PI * i / (float)stacks;
+    }
+    for (int j = 0; j < thetaCount; ++j) {
+        angles[phiCount + j] = 2 * PI * j / (float)slices;
+    }
+    utils_sincos_batch(angles, sinTable, cosTable, phiCount + thetaCount, UTILS_SINCOS_PRECISE);
+    const float* sinTheta = sinTable + phiCount;
+    const float* cosTheta = cosTable + phiCount;
+
     int index = 0;
     for (int i = 0; i <= stacks; ++i) {
-        float phi1 = PI * i / (float)stacks;
-        float phi2 = PI * (i + 1) / (float)stacks;
+        float ringRadius = radius * sinTable[i];
+        float y = radius * cosTable[i];
         for (int j = 0; j <= slices; ++j) {
-            float theta = 2 * PI * j / (float)slices;
-            
-            float x1 = radius * sinf(phi1) * cosf(theta);
-            float y1 = radius * cosf(phi1);
-            float z1 = radius * sinf(phi1) * sinf(theta);
-            
-            float x2 = radius * sinf(phi2) * cosf(theta);
-            float y2 = radius * cosf(phi2);
-            float z2 = radius * sinf(phi2) * sinf(theta);
-            
-            (*vertices)[index++] = x1;
-            (*vertices)[index++] = y1;
-            (*vertices)[index++] = z1;
-            
-            (*vertices)[index++] = x2;
-            (*vertices)[index++] = y2;
-            (*vertices)[index++] = z2;
+            mesh->vertices[index++] = ringRadius * cosTheta[j];
+            mesh->vertices[index++] = y;
+            mesh->vertices[index++] = ringRadius * sinTheta[j];
         }
     }
+    free(angles);
+
+    // Rows are emitted top to bottom, so the upper hemisphere is a prefix of the index buffer
+    int rowIndexCount = primitiveRestart ? 2 * ringSize + 1 : 6 * slices;
+    mesh->mode = primitiveRestart ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+    mesh->indexCount = stacks * rowIndexCount;
+    mesh->upperIndexCount = (stacks / 2) * rowIndexCount;
+    mesh->indices = (unsigned int*)malloc(mesh->indexCount * sizeof(unsigned int));
+
+    index = 0;
+    for (int i = 0; i < stacks; ++i) {
+        unsigned int top = i * ringSize;
+        unsigned int bottom = top + ringSize;
+        if (primitiveRestart) {
+            for (int j = 0; j <= slices; ++j) {
+                mesh->indices[index++] = top + j;
+                mesh->indices[index++] = bottom + j;
+            }
+            mesh->indices[index++] = SPHERE_RESTART_INDEX;
+        } else {
+            for (int j = 0; j < slices; ++j) {
+                mesh->indices[index++] = top + j;
+                mesh->indices[index++] = bottom + j;
+                mesh->indices[index++] = top + j + 1;
+                mesh->indices[index++] = top + j + 1;
+                mesh->indices[index++] = bottom + j;
+                mesh->indices[index++] = bottom + j + 1;
+            }
+        }
+    }
+}
+
+void freeSphereMesh(SphereMesh* mesh) {
+    free(mesh->vertices);
+    free(mesh->indices);
+    mesh->vertices = NULL;
+    mesh->indices = NULL;
 }
 
 // Camera structure
@@ -115,10 +174,13 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
     if(camera.pitch < -89.0f)
         camera.pitch = -89.0f;
 
+    float sinYaw, cosYaw, sinPitch, cosPitch;
+    utils_sincosf(glm_rad(camera.yaw), &sinYaw, &cosYaw);
+    utils_sincosf(glm_rad(camera.pitch), &sinPitch, &cosPitch);
     vec3 front;
-    front[0] = cos(glm_rad(camera.yaw)) * cos(glm_rad(camera.pitch));
-    front[1] = sin(glm_rad(camera.pitch));
-    front[2] = sin(glm_rad(camera.yaw)) * cos(glm_rad(camera.pitch));
+    front[0] = cosYaw * cosPitch;
+    front[1] = sinPitch;
+    front[2] = sinYaw * cosPitch;
     glm_normalize(front);
     glm_vec3_copy(front, camera.front);
 }
@@ -206,22 +268,49 @@ int main() {
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
 
-    // Create sphere mesh
-    float* vertices;
-    int vertexCount;
-    createSphereMesh(10.0f, 64, 64, &vertices, &vertexCount);
+    // Resolve uniform locations once; the render loop only uses these
+    UtilsUniformTable uniforms;
+    utils_uniform_table_init(&uniforms, shaderProgram);
+    int projectionLoc = utils_uniform_location(&uniforms, "projection");
+    int viewLoc = utils_uniform_location(&uniforms, "view");
+    int modelLoc = utils_uniform_location(&uniforms, "model");
+    int showSkyLoc = utils_uniform_location(&uniforms, "showSky");
+    int showWaterLoc = utils_uniform_location(&uniforms, "showWater");
+
+    // Create sphere mesh; strips with restart indices where the fixed restart index exists
+    bool primitiveRestart = GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility;
+    SphereMesh sphere;
+    createSphereMesh(10.0f, 64, 64, primitiveRestart, &sphere);
+    if (primitiveRestart) {
+        glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+    }
 
-    // Create VAO and VBO
-    unsigned int VAO, VBO;
+    // Positions as unorm16 inside the dome's bounds (8 bytes instead of 12); the shader gets
+    // them back through the dequantize matrix folded into the model matrix
+    UtilsQuantizedLayout sphereLayout;
+    unsigned char* spherePacked = utils_mesh_quantize(sphere.vertices, sphere.vertexCount, 3, -1, -1, &sphereLayout);
+    if (!spherePacked) {
+        printf("Failed to quantize sphere\n");
+        return -1;
+    }
+    mat4 sphereDequantize;
+    memcpy(sphereDequantize, sphereLayout.dequantize, sizeof(sphereDequantize));
+
+    // Create VAO, VBO and EBO
+    unsigned int VAO, VBO, EBO;
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
 
     glBindVertexArray(VAO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertexCount * 3 * sizeof(float), vertices, GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, sphere.vertexCount * sphereLayout.stride, spherePacked, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sphere.indexCount * sizeof(unsigned int), sphere.indices, GL_STATIC_DRAW);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, (GLsizei)sphereLayout.stride, (void*)0);
     glEnableVertexAttribArray(0);
+    free(spherePacked);
 
     // Enable depth testing
     glEnable(GL_DEPTH_TEST);
@@ -243,21 +332,21 @@ int main() {
                                            camera.position[1] + camera.front[1], 
                                            camera.position[2] + camera.front[2]}, 
                    camera.up, view);
-        glm_mat4_identity(model);
+        glm_mat4_copy(sphereDequantize, model);
 
         glUseProgram(shaderProgram);
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, (float*)projection);
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, (float*)view);
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, (float*)model);
+        utils_uniform_set_mat4(projectionLoc, (float*)projection);
+        utils_uniform_set_mat4(viewLoc, (float*)view);
+        utils_uniform_set_mat4(modelLoc, (float*)model);
         
         // Set uniforms for sky and water visibility
-        glUniform1i(glGetUniformLocation(shaderProgram, "showSky"), showSky);
-        glUniform1i(glGetUniformLocation(shaderProgram, "showWater"), showWater);
+        utils_uniform_set_int(showSkyLoc, showSky);
+        utils_uniform_set_int(showWaterLoc, showWater);
 
+        // The whole dome in one call; without water only the upper hemisphere is drawn
         glBindVertexArray(VAO);
-        for (int i = 0; i < vertexCount - 2; i += 2) {
-    glDrawArrays(GL_TRIANGLE_STRIP, i, 4);
-}
+        int indexCount = showWater ? sphere.indexCount : sphere.upperIndexCount;
+        glDrawElements(sphere.mode, indexCount, GL_UNSIGNED_INT, (void*)0);
 
         glfwSwapBuffers(window);
         glfwPollEvents();
@@ -266,8 +355,10 @@ int main() {
     // Clean up
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
     glDeleteProgram(shaderProgram);
-    free(vertices);
+    utils_uniform_table_free(&uniforms);
+    freeSphereMesh(&sphere);
 
     glfwTerminate();
     return 0;
@@ -5,11 +5,11 @@
 #include <emscripten/html5.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include "Utils.h"
 
 // Function prototypes
-char* loadShaderSource(const char* filename);
-GLuint compileShader(GLenum type, const char* source);
-GLuint createShaderProgram(const char* vertexSource, const char* fragmentSource);
+GLuint compileShader(GLenum type, const UtilsFileView* source);
+GLuint createShaderProgram(const UtilsFileView* vertexSource, const UtilsFileView* fragmentSource);
 void setupShaders();
 void setupVBO();
 void setupMatrices();
@@ -17,38 +17,15 @@ void drawFrame();
 
 // VBO and shader program
 GLuint vbo, vao, shaderProgram;
+GLsizei indexCount;
 GLuint modelLoc, viewLoc, projectionLoc;
 mat4 modelMatrix, viewMatrix, projectionMatrix;
 
 
-char* loadShaderSource(const char* filename) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
-        printf("Failed to open file: %s\n", filename);
-        return NULL;
-    }
-
-    fseek(file, 0, SEEK_END);
-    long length = ftell(file);
-    fseek(file, 0, SEEK_SET);
-
-    char* buffer = (char*)malloc(length + 1);
-    if (!buffer) {
-        printf("Failed to allocate memory for shader source\n");
-        fclose(file);
-        return NULL;
-    }
-
-    fread(buffer, 1, length, file);
-    buffer[length] = '\0';
-
-    fclose(file);
-    return buffer;
-}
-
-GLuint compileShader(GLenum type, const char* source) {
+GLuint compileShader(GLenum type, const UtilsFileView* source) {
     GLuint shader = glCreateShader(type);
-    glShaderSource(shader, 1, &source, NULL);
+    GLint length = (GLint)source->length;
+    glShaderSource(shader, 1, &source->data, &length);
     glCompileShader(shader);
 
     GLint success;
@@ -63,7 +40,7 @@ GLuint compileShader(GLenum type, const char* source) {
     return shader;
 }
 
-GLuint createShaderProgram(const char* vertexSource, const char* fragmentSource) {
+GLuint createShaderProgram(const UtilsFileView* vertexSource, const UtilsFileView* fragmentSource) {
     GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
     GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
 
@@ -92,21 +69,25 @@ GLuint createShaderProgram(const char* vertexSource, const char* fragmentSource)
 }
 
 void setupShaders() {
-    char* vertexShaderSource = loadShaderSource("vertex.glsl");
-    char* fragmentShaderSource = loadShaderSource("fragment.glsl");
-
-    if (!vertexShaderSource || !fragmentShaderSource) {
+    UtilsFileView vertexShaderSource;
+    UtilsFileView fragmentShaderSource;
+    if (!utils_file_view_open("vertex.glsl", &vertexShaderSource)) {
+        printf("Failed to load shader sources\n");
+        return;
+    }
+    if (!utils_file_view_open("fragment.glsl", &fragmentShaderSource)) {
         printf("Failed to load shader sources\n");
+        utils_file_view_close(&vertexShaderSource);
         return;
     }
 
-    printf("Vertex Shader Source:\n%s\n", vertexShaderSource);
-    printf("Fragment Shader Source:\n%s\n", fragmentShaderSource);
+    printf("Vertex Shader Source:\n%.*s\n", (int)vertexShaderSource.length, vertexShaderSource.data);
+    printf("Fragment Shader Source:\n%.*s\n", (int)fragmentShaderSource.length, fragmentShaderSource.data);
 
-    shaderProgram = createShaderProgram(vertexShaderSource, fragmentShaderSource);
+    shaderProgram = createShaderProgram(&vertexShaderSource, &fragmentShaderSource);
 
-    free(vertexShaderSource);
-    free(fragmentShaderSource);
+    utils_file_view_close(&vertexShaderSource);
+    utils_file_view_close(&fragmentShaderSource);
 
     if (!shaderProgram) {
         printf("Failed to create shader program\n");
@@ -145,18 +126,29 @@ void setupVBO() {
         1, 2, 6, 6, 5, 1
     };
 
+    // Reorder the faces for the vertex cache and the vertices for fetch locality
+    UtilsMesh mesh;
+    if (!utils_mesh_optimize(vertices, 8, 6, indices, 36, &mesh)) {
+        printf("Failed to optimize cube mesh\n");
+        return;
+    }
+    printf("Cube ACMR %.2f -> %.2f, ATVR %.2f -> %.2f\n", mesh.before.acmr, mesh.after.acmr,
+           mesh.before.atvr, mesh.after.atvr);
+    indexCount = (GLsizei)mesh.index_count;
+
     glGenVertexArrays(1, &vao);
     glGenBuffers(1, &vbo);
 
     glBindVertexArray(vao);
 
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, mesh.vertex_count * 6 * sizeof(GLfloat), mesh.vertices, GL_STATIC_DRAW);
 
     GLuint ebo;
     glGenBuffers(1, &ebo);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.index_count * sizeof(GLuint), mesh.indices, GL_STATIC_DRAW);
+    utils_mesh_free(&mesh);
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void*)0);
     glEnableVertexAttribArray(0);
@@ -184,7 +176,7 @@ void drawFrame() {
     glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, (const GLfloat*)projectionMatrix);
 
     glBindVertexArray(vao);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
 
     glBindVertexArray(0);
     glUseProgram(0);